@@ -0,0 +1,126 @@
+// Compares the memory traffic of the framebuffer and hit record layouts:
+// the double Vec3 framebuffer with RGB24 upload against ColorF with RGBA8,
+// and copies of the previous 104-byte HitRecord against the current one.
+// Usage: bandwidth_bench [width height]
+#include "Framebuffer.hpp"
+#include "Hittable.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+// HitRecord as it was before the float fields, for comparison.
+struct LegacyHitRecord
+{
+	Vec3 p;
+	Vec3 normal;
+	double t = 0.0;
+	int object_id = -1;
+	int material_id = -1;
+	bool front_face = false;
+	double beam_ratio = 0.0;
+	double u = 0.0;
+	double v = 0.0;
+	bool has_uv = false;
+};
+
+constexpr int kFrames = 20;
+
+template <typename F> double time_ms(F &&body)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < kFrames; ++i)
+		body(i);
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+													 start)
+			   .count() /
+		   kFrames;
+}
+
+Vec3 shade(size_t i, int frame)
+{
+	double f = static_cast<double>((i * 2654435761u + frame) & 0xFFFF) / 65535.0;
+	return Vec3(f, 1.0 - f, 0.5 * f);
+}
+
+void report(const char *name, double bytes, double ms)
+{
+	std::printf("%-28s %8.2f MB/frame %8.3f ms %8.2f GB/s\n", name, bytes / 1e6, ms,
+				bytes / (ms * 1e6));
+}
+
+template <typename Record> double copy_ms(std::vector<Record> &src, std::vector<Record> &dst)
+{
+	return time_ms(
+		[&](int frame)
+		{
+			// Closest-hit style: every candidate overwrites the record.
+			for (size_t i = 0; i < src.size(); ++i)
+			{
+				src[i].t = frame + static_cast<double>(i);
+				dst[i] = src[i];
+			}
+		});
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	int width = argc > 2 ? std::atoi(argv[1]) : 1920;
+	int height = argc > 2 ? std::atoi(argv[2]) : 1080;
+	if (width <= 0 || height <= 0)
+	{
+		width = 1920;
+		height = 1080;
+	}
+	const size_t n = static_cast<size_t>(width) * height;
+	std::printf("%dx%d, %d frames\n", width, height, kFrames);
+
+	std::vector<Vec3> legacy_fb(n);
+	std::vector<unsigned char> legacy_px(n * 3);
+	double legacy = time_ms(
+		[&](int frame)
+		{
+			for (size_t i = 0; i < n; ++i)
+				legacy_fb[i] = shade(i, frame);
+			for (size_t i = 0; i < n; ++i)
+			{
+				const Vec3 &c = legacy_fb[i];
+				legacy_px[i * 3 + 0] = static_cast<unsigned char>(
+					std::lround(std::clamp(c.x, 0.0, 1.0) * 255.0));
+				legacy_px[i * 3 + 1] = static_cast<unsigned char>(
+					std::lround(std::clamp(c.y, 0.0, 1.0) * 255.0));
+				legacy_px[i * 3 + 2] = static_cast<unsigned char>(
+					std::lround(std::clamp(c.z, 0.0, 1.0) * 255.0));
+			}
+		});
+	// Store, reload and upload buffer per frame.
+	report("Vec3 + RGB24", n * (2.0 * sizeof(Vec3) + 3.0), legacy);
+
+	std::vector<ColorF> fb(n);
+	std::vector<unsigned char> px(n * 4);
+	double current = time_ms(
+		[&](int frame)
+		{
+			for (size_t i = 0; i < n; ++i)
+				fb[i] = ColorF(shade(i, frame));
+			pack_rgba8(fb.data(), n, px.data());
+		});
+	report("ColorF + RGBA8", n * (2.0 * sizeof(ColorF) + 4.0), current);
+
+	std::vector<LegacyHitRecord> legacy_src(n), legacy_dst(n);
+	double legacy_copy = copy_ms(legacy_src, legacy_dst);
+	std::vector<HitRecord> src(n), dst(n);
+	double copy = copy_ms(src, dst);
+	std::printf("\nHitRecord: %zu bytes (was %zu)\n", sizeof(HitRecord),
+				sizeof(LegacyHitRecord));
+	report("LegacyHitRecord copies", n * 2.0 * sizeof(LegacyHitRecord), legacy_copy);
+	report("HitRecord copies", n * 2.0 * sizeof(HitRecord), copy);
+	return 0;
+}
@@ -0,0 +1,91 @@
+// Measures precise_collision throughput over randomised shape pairs.
+// Usage: collision_bench [pairs]
+#include "Collision.hpp"
+#include "Cone.hpp"
+#include "Cube.hpp"
+#include "Cylinder.hpp"
+#include "Plane.hpp"
+#include "Sphere.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const ShapeType kKinds[] = {ShapeType::Sphere, ShapeType::Cube, ShapeType::Cylinder,
+							ShapeType::Cone, ShapeType::Plane};
+const char *const kNames[] = {"sphere", "cube", "cylinder", "cone", "plane"};
+constexpr int kKindCount = 5;
+
+HittablePtr make_shape(ShapeType kind, std::mt19937 &rng)
+{
+	std::uniform_real_distribution<double> pos(-2.0, 2.0);
+	std::uniform_real_distribution<double> size(0.3, 1.5);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	Vec3 c(pos(rng), pos(rng), pos(rng));
+	Vec3 dir(unit(rng), unit(rng), unit(rng));
+	if (dir.length_squared() < 1e-6)
+		dir = Vec3(0, 1, 0);
+	dir = dir.normalized();
+	switch (kind)
+	{
+	case ShapeType::Sphere:
+		return std::make_shared<Sphere>(c, size(rng), 0, 0);
+	case ShapeType::Cube:
+		return std::make_shared<Cube>(c, dir, size(rng), size(rng), size(rng), 0, 0);
+	case ShapeType::Cylinder:
+		return std::make_shared<Cylinder>(c, dir, size(rng), 2 * size(rng), 0, 0);
+	case ShapeType::Cone:
+		return std::make_shared<Cone>(c, dir, size(rng), 2 * size(rng), 0, 0);
+	default:
+		return std::make_shared<Plane>(c, dir, 0, 0);
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	int pairs = argc > 1 ? std::atoi(argv[1]) : 20000;
+	if (pairs <= 0)
+		pairs = 20000;
+	constexpr int kRepeats = 20;
+	std::mt19937 rng(1234);
+	double total_seconds = 0.0;
+	long total_tests = 0;
+	std::printf("%-20s %12s %8s\n", "pair", "tests/s", "overlap");
+	for (int i = 0; i < kKindCount; ++i)
+	{
+		for (int j = i; j < kKindCount; ++j)
+		{
+			if (kKinds[i] == ShapeType::Plane && kKinds[j] == ShapeType::Plane)
+				continue;
+			std::vector<HittablePtr> a, b;
+			for (int k = 0; k < pairs; ++k)
+			{
+				a.push_back(make_shape(kKinds[i], rng));
+				b.push_back(make_shape(kKinds[j], rng));
+			}
+			long overlaps = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (int r = 0; r < kRepeats; ++r)
+				for (int k = 0; k < pairs; ++k)
+					overlaps += precise_collision(a[k], b[k]) ? 1 : 0;
+			double seconds = std::chrono::duration<double>(
+								 std::chrono::steady_clock::now() - start)
+								 .count();
+			long tests = static_cast<long>(pairs) * kRepeats;
+			total_seconds += seconds;
+			total_tests += tests;
+			char name[32];
+			std::snprintf(name, sizeof(name), "%s-%s", kNames[i], kNames[j]);
+			std::printf("%-20s %12.0f %7.1f%%\n", name, tests / seconds,
+						100.0 * overlaps / tests);
+		}
+	}
+	std::printf("%-20s %12.0f\n", "total", total_tests / total_seconds);
+	return 0;
+}
@@ -0,0 +1,541 @@
+// Microbenchmarks for the intersection, BVH, shading, beam and collision
+// kernels, built without SDL. Each benchmark is calibrated to a batch of at
+// least kMinSampleMs and then timed over several batches; --save stores the
+// per-batch timings and --compare tests a run against them with a
+// Mann-Whitney U test, so noise is not reported as a change.
+// Usage: minirt_bench [--scene file.toml]... [--filter text] [--samples N]
+//                     [--save baseline.txt] [--compare baseline.txt]
+#include "BVH.hpp"
+#include "Camera.hpp"
+#include "Collision.hpp"
+#include "Cone.hpp"
+#include "Cube.hpp"
+#include "Cylinder.hpp"
+#include "Laser.hpp"
+#include "Parser.hpp"
+#include "Plane.hpp"
+#include "Scene.hpp"
+#include "Shading.hpp"
+#include "Sphere.hpp"
+#include "material.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr double kMinSampleMs = 5.0;
+constexpr int kShapeCount = 256;
+constexpr int kRayCount = 1024;
+// |z| above this is a change at p < 0.01 (two-sided).
+constexpr double kSignificantZ = 2.576;
+
+// Results are folded into this so the compiler cannot drop the work.
+volatile double g_sink = 0.0;
+
+struct Benchmark
+{
+	std::string name;
+	// Runs the kernel `iterations` times.
+	std::function<double(long iterations)> run;
+};
+
+struct BenchScene
+{
+	std::string label;
+	Scene scene;
+	Camera cam{{0, 2, -15}, {0, 0, 0}, 60.0, 4.0 / 3.0};
+	std::vector<Material> mats;
+	std::vector<Ray> rays;
+	std::vector<HitRecord> hits;
+	std::vector<Ray> hit_rays;
+};
+
+HittablePtr make_shape(ShapeType kind, std::mt19937 &rng, int oid)
+{
+	std::uniform_real_distribution<double> pos(-8.0, 8.0);
+	std::uniform_real_distribution<double> size(0.3, 1.5);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	Vec3 c(pos(rng), pos(rng) * 0.5 + 2.0, pos(rng));
+	Vec3 dir(unit(rng), unit(rng), unit(rng));
+	if (dir.length_squared() < 1e-6)
+		dir = Vec3(0, 1, 0);
+	dir = dir.normalized();
+	switch (kind)
+	{
+	case ShapeType::Sphere:
+		return std::make_shared<Sphere>(c, size(rng), oid, 0);
+	case ShapeType::Cube:
+		return std::make_shared<Cube>(c, dir, size(rng), size(rng), size(rng), oid, 0);
+	case ShapeType::Cylinder:
+		return std::make_shared<Cylinder>(c, dir, size(rng), 2 * size(rng), oid, 0);
+	case ShapeType::Cone:
+		return std::make_shared<Cone>(c, dir, size(rng), 2 * size(rng), oid, 0);
+	case ShapeType::Beam:
+		return std::make_shared<Laser>(c, dir, 4 * size(rng), 1.0, oid, 0);
+	default:
+		return std::make_shared<Plane>(c, dir, oid, 0);
+	}
+}
+
+// Rays from a shell around the shapes towards points near the centre, so
+// about half of them hit something.
+std::vector<Ray> random_rays(std::mt19937 &rng, int count)
+{
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	std::vector<Ray> rays;
+	rays.reserve(count);
+	while (static_cast<int>(rays.size()) < count)
+	{
+		Vec3 from(unit(rng), unit(rng), unit(rng));
+		if (from.length_squared() < 1e-3)
+			continue;
+		from = from.normalized() * 20.0;
+		Vec3 to(unit(rng) * 6.0, unit(rng) * 4.0 + 2.0, unit(rng) * 6.0);
+		rays.push_back(Ray(from, (to - from).normalized()));
+	}
+	return rays;
+}
+
+void build_random_scene(BenchScene &bs, std::mt19937 &rng)
+{
+	const ShapeType kinds[] = {ShapeType::Sphere, ShapeType::Cube, ShapeType::Cylinder,
+							   ShapeType::Cone};
+	std::uniform_real_distribution<double> channel(0.1, 1.0);
+	for (int m = 0; m < 4; ++m)
+	{
+		Material mat;
+		mat.color = mat.base_color = Vec3(channel(rng), channel(rng), channel(rng));
+		mat.mirror = m == 1;
+		mat.alpha = m == 2 ? 0.5 : 1.0;
+		bs.mats.push_back(mat);
+	}
+	Scene &scene = bs.scene;
+	scene.ambient = Ambient(Vec3(1, 1, 1), 0.2);
+	scene.objects.push_back(std::make_shared<Plane>(Vec3(0, 0, 0), Vec3(0, 1, 0), 0, 0));
+	for (int i = 1; i <= 80; ++i)
+	{
+		HittablePtr shape = make_shape(kinds[i % 4], rng, i);
+		shape->material_id = i % static_cast<int>(bs.mats.size());
+		scene.objects.push_back(shape);
+	}
+	scene.lights.emplace_back(Vec3(0, 12, -6), Vec3(1, 1, 1), 0.8);
+	scene.lights.emplace_back(Vec3(-8, 6, 4), Vec3(1, 0.8, 0.6), 0.5);
+	scene.lights.emplace_back(Vec3(8, 3, -2), Vec3(0.6, 0.8, 1), 0.5, std::vector<int>{},
+							  -1, Vec3(-1, -0.2, 0.1), 0.8, 25.0);
+	scene.update_beams(bs.mats);
+	scene.build_bvh();
+}
+
+// Camera rays on a coarse grid, and the hits they produce.
+void prepare_rays(BenchScene &bs)
+{
+	const int w = 64;
+	const int h = 48;
+	bs.cam.aspect = static_cast<double>(w) / h;
+	PixelGrid grid = bs.cam.pixel_grid(w, h);
+	for (int y = 0; y < h; ++y)
+		for (int x = 0; x < w; ++x)
+			bs.rays.push_back(Ray(grid.origin, grid.direction(x, y).normalized()));
+	for (const Ray &r : bs.rays)
+	{
+		HitRecord rec;
+		if (bs.scene.hit(r, 1e-4, 1e9, rec))
+		{
+			bs.hits.push_back(rec);
+			bs.hit_rays.push_back(r);
+		}
+	}
+}
+
+void add_kernel_benchmarks(std::vector<Benchmark> &out, std::mt19937 &rng)
+{
+	auto rays = std::make_shared<std::vector<Ray>>(random_rays(rng, kRayCount));
+	const std::pair<ShapeType, const char *> shapes[] = {
+		{ShapeType::Sphere, "sphere"},	   {ShapeType::Cube, "cube"},
+		{ShapeType::Cylinder, "cylinder"}, {ShapeType::Cone, "cone"},
+		{ShapeType::Plane, "plane"},	   {ShapeType::Beam, "laser"}};
+	for (const auto &kind : shapes)
+	{
+		auto objects = std::make_shared<std::vector<HittablePtr>>();
+		for (int i = 0; i < kShapeCount; ++i)
+			objects->push_back(make_shape(kind.first, rng, i));
+		out.push_back({std::string("hit/") + kind.second, [objects, rays](long n) {
+						   double sum = 0.0;
+						   HitRecord rec;
+						   for (long i = 0; i < n; ++i)
+						   {
+							   const Ray &r = (*rays)[i % kRayCount];
+							   if ((*objects)[i % kShapeCount]->hit(r, 1e-4, 1e9, rec))
+								   sum += rec.t;
+						   }
+						   return sum;
+					   }});
+	}
+
+	auto boxes = std::make_shared<std::vector<AABB>>();
+	for (int i = 0; i < kShapeCount; ++i)
+	{
+		AABB box;
+		make_shape(ShapeType::Cube, rng, i)->bounding_box(box);
+		boxes->push_back(box);
+	}
+	auto inv_dirs = std::make_shared<std::vector<Vec3>>();
+	for (const Ray &r : *rays)
+		inv_dirs->push_back(Vec3(1.0 / r.dir.x, 1.0 / r.dir.y, 1.0 / r.dir.z));
+	out.push_back({"aabb/hit", [boxes, rays, inv_dirs](long n) {
+					   double sum = 0.0;
+					   for (long i = 0; i < n; ++i)
+					   {
+						   int r = i % kRayCount;
+						   sum += (*boxes)[i % kShapeCount].hit((*rays)[r].orig, (*inv_dirs)[r],
+															   1e-4, 1e9);
+					   }
+					   return sum;
+				   }});
+
+	const ShapeType kinds[] = {ShapeType::Sphere, ShapeType::Cube, ShapeType::Cylinder,
+							   ShapeType::Cone, ShapeType::Plane};
+	auto pairs = std::make_shared<std::vector<std::pair<HittablePtr, HittablePtr>>>();
+	std::uniform_real_distribution<double> near(-1.5, 1.5);
+	for (int i = 0; i < kShapeCount; ++i)
+	{
+		HittablePtr a = make_shape(kinds[i % 5], rng, 0);
+		HittablePtr b = make_shape(kinds[(i / 5) % 5], rng, 1);
+		// Move b next to a so that a good share of the pairs touch.
+		AABB ba, bb;
+		a->bounding_box(ba);
+		b->bounding_box(bb);
+		Vec3 offset = (ba.min + ba.max) * 0.5 - (bb.min + bb.max) * 0.5 +
+					  Vec3(near(rng), near(rng), near(rng));
+		b->translate(offset);
+		pairs->push_back({a, b});
+	}
+	out.push_back({"collision/precise", [pairs](long n) {
+					   double sum = 0.0;
+					   for (long i = 0; i < n; ++i)
+					   {
+						   const auto &p = (*pairs)[i % kShapeCount];
+						   sum += precise_collision(p.first, p.second) ? 1.0 : 0.0;
+					   }
+					   return sum;
+				   }});
+}
+
+void add_scene_benchmarks(std::vector<Benchmark> &out, std::shared_ptr<BenchScene> bs)
+{
+	const std::string suffix = "/" + bs->label;
+	// Beams first: update_beams replaces objects, so the BVH is rebuilt
+	// by the next benchmark before anything traverses it.
+	out.push_back({"beams/update" + suffix, [bs](long n) {
+					   for (long i = 0; i < n; ++i)
+						   bs->scene.update_beams(bs->mats);
+					   return static_cast<double>(bs->scene.objects.size());
+				   }});
+	out.push_back({"bvh/build" + suffix, [bs](long n) {
+					   for (long i = 0; i < n; ++i)
+						   bs->scene.build_bvh();
+					   return static_cast<double>(bs->scene.objects.size());
+				   }});
+	out.push_back({"bvh/traverse" + suffix, [bs](long n) {
+					   double sum = 0.0;
+					   HitRecord rec;
+					   size_t count = bs->rays.size();
+					   for (long i = 0; i < n; ++i)
+						   if (bs->scene.hit(bs->rays[i % count], 1e-4, 1e9, rec))
+							   sum += rec.t;
+					   return sum;
+				   }});
+	if (bs->hits.empty())
+		return;
+	out.push_back({"shade/phong" + suffix, [bs](long n) {
+					   double sum = 0.0;
+					   size_t count = bs->hits.size();
+					   for (long i = 0; i < n; ++i)
+					   {
+						   const HitRecord &rec = bs->hits[i % count];
+						   Vec3 eye = bs->hit_rays[i % count].dir * -1.0;
+						   Vec3 c = phong(bs->mats[rec.material_id], bs->scene.ambient,
+										  bs->scene.lights, rec.p, rec.normal, eye);
+						   sum += c.x + c.y + c.z;
+					   }
+					   return sum;
+				   }});
+	out.push_back({"shade/light_contribution" + suffix, [bs](long n) {
+					   std::vector<PreparedLight> lights;
+					   for (const PointLight &L : bs->scene.lights)
+						   lights.push_back(prepare_light(L));
+					   if (lights.empty())
+						   return 0.0;
+					   double sum = 0.0;
+					   size_t count = bs->hits.size();
+					   for (long i = 0; i < n; ++i)
+					   {
+						   const HitRecord &rec = bs->hits[(i / lights.size()) % count];
+						   const Material &m = bs->mats[rec.material_id];
+						   Vec3 surface = surface_color_at(bs->scene, rec, m);
+						   Vec3 eye = bs->hit_rays[(i / lights.size()) % count].dir * -1.0;
+						   Vec3 c = light_contribution(bs->scene, bs->mats,
+													   lights[i % lights.size()], rec, surface,
+													   m, rec.p, eye);
+						   sum += c.x + c.y + c.z;
+					   }
+					   return sum;
+				   }});
+	bool has_spotlight = false;
+	for (const PointLight &L : bs->scene.lights)
+		has_spotlight = has_spotlight || L.beam_spotlight;
+	if (!has_spotlight)
+		return;
+	out.push_back({"score/spotlight_area" + suffix, [bs](long n) {
+					   double sum = 0.0;
+					   for (long i = 0; i < n; ++i)
+						   for (const PointLight &L : bs->scene.lights)
+							   if (L.beam_spotlight)
+								   sum += integrate_spotlight_area(bs->scene, bs->mats, L);
+					   return sum;
+				   }});
+}
+
+// Nanoseconds per iteration for each of `samples` batches.
+std::vector<double> measure(const Benchmark &b, int samples)
+{
+	using Clock = std::chrono::steady_clock;
+	long iterations = 1;
+	for (;;)
+	{
+		auto start = Clock::now();
+		g_sink = g_sink + b.run(iterations);
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (ms >= kMinSampleMs || iterations >= (1L << 40))
+			break;
+		iterations *= ms > 0.5 ? std::max(2L, static_cast<long>(kMinSampleMs / ms) + 1) : 8;
+	}
+	std::vector<double> ns;
+	for (int s = 0; s < samples; ++s)
+	{
+		auto start = Clock::now();
+		g_sink = g_sink + b.run(iterations);
+		double elapsed =
+			std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		ns.push_back(elapsed / iterations);
+	}
+	return ns;
+}
+
+double median(std::vector<double> v)
+{
+	if (v.empty())
+		return 0.0;
+	std::sort(v.begin(), v.end());
+	size_t mid = v.size() / 2;
+	return v.size() % 2 ? v[mid] : 0.5 * (v[mid - 1] + v[mid]);
+}
+
+double median_abs_deviation(const std::vector<double> &v)
+{
+	double m = median(v);
+	std::vector<double> dev;
+	for (double x : v)
+		dev.push_back(std::fabs(x - m));
+	return median(dev);
+}
+
+// z score of the Mann-Whitney U statistic for `b` against `a`; positive
+// when b tends to be larger (slower).
+double mann_whitney_z(const std::vector<double> &a, const std::vector<double> &b)
+{
+	std::vector<std::pair<double, int>> all;
+	for (double x : a)
+		all.push_back({x, 0});
+	for (double x : b)
+		all.push_back({x, 1});
+	std::sort(all.begin(), all.end());
+	double rank_sum_b = 0.0;
+	for (size_t i = 0; i < all.size();)
+	{
+		size_t j = i;
+		while (j < all.size() && all[j].first == all[i].first)
+			++j;
+		double rank = 0.5 * (i + 1 + j); // average rank of the tie group
+		for (size_t k = i; k < j; ++k)
+			if (all[k].second == 1)
+				rank_sum_b += rank;
+		i = j;
+	}
+	double na = static_cast<double>(a.size());
+	double nb = static_cast<double>(b.size());
+	double u = rank_sum_b - nb * (nb + 1.0) / 2.0;
+	double mean = na * nb / 2.0;
+	double sigma = std::sqrt(na * nb * (na + nb + 1.0) / 12.0);
+	return sigma > 0.0 ? (u - mean) / sigma : 0.0;
+}
+
+bool load_baseline(const std::string &path, std::map<std::string, std::vector<double>> &out)
+{
+	std::ifstream in(path);
+	if (!in)
+		return false;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ss(line);
+		std::string name;
+		int count = 0;
+		if (!(ss >> name >> count) || count <= 0)
+			return false;
+		std::vector<double> samples(count);
+		for (double &s : samples)
+			if (!(ss >> s))
+				return false;
+		out[name] = samples;
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> scene_paths;
+	std::string filter, save_path, compare_path;
+	int samples = 15;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string flag = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::fprintf(stderr, "%s needs a value\n", flag.c_str());
+			return 1;
+		}
+		const char *value = argv[++i];
+		if (flag == "--scene")
+			scene_paths.push_back(value);
+		else if (flag == "--filter")
+			filter = value;
+		else if (flag == "--samples")
+			samples = std::max(3, std::atoi(value));
+		else if (flag == "--save")
+			save_path = value;
+		else if (flag == "--compare")
+			compare_path = value;
+		else
+		{
+			std::fprintf(stderr,
+						 "Usage: %s [--scene file.toml]... [--filter text] [--samples N]"
+						 " [--save file] [--compare file]\n",
+						 argv[0]);
+			return 1;
+		}
+	}
+	if (scene_paths.empty())
+	{
+		std::ifstream probe("scenes/level_1.toml");
+		if (probe)
+			scene_paths.push_back("scenes/level_1.toml");
+	}
+
+	std::map<std::string, std::vector<double>> baseline;
+	if (!compare_path.empty() && !load_baseline(compare_path, baseline))
+	{
+		std::fprintf(stderr, "Cannot read baseline %s\n", compare_path.c_str());
+		return 1;
+	}
+
+	std::mt19937 rng(1234);
+	std::vector<Benchmark> benchmarks;
+	add_kernel_benchmarks(benchmarks, rng);
+	auto random_scene = std::make_shared<BenchScene>();
+	random_scene->label = "random";
+	build_random_scene(*random_scene, rng);
+	prepare_rays(*random_scene);
+	add_scene_benchmarks(benchmarks, random_scene);
+	for (const std::string &path : scene_paths)
+	{
+		auto bs = std::make_shared<BenchScene>();
+		size_t slash = path.find_last_of("/\\");
+		bs->label = path.substr(slash == std::string::npos ? 0 : slash + 1);
+		if (!Parser::parse_rt_file(path, bs->scene, bs->cam, 64, 48))
+		{
+			std::fprintf(stderr, "Cannot parse scene %s\n", path.c_str());
+			return 1;
+		}
+		bs->mats = Parser::get_materials();
+		bs->scene.update_beams(bs->mats);
+		bs->scene.build_bvh();
+		prepare_rays(*bs);
+		add_scene_benchmarks(benchmarks, bs);
+	}
+
+	std::ofstream save;
+	if (!save_path.empty())
+	{
+		save.open(save_path);
+		save << "# minirt_bench baseline: name, sample count, ns per iteration\n";
+	}
+	std::printf("%-40s %12s %7s", "benchmark", "ns/op", "+-%");
+	if (!baseline.empty())
+		std::printf(" %12s %8s", "baseline", "change");
+	std::printf("\n");
+	int slower = 0;
+	int faster = 0;
+	for (const Benchmark &b : benchmarks)
+	{
+		if (!filter.empty() && b.name.find(filter) == std::string::npos)
+			continue;
+		std::vector<double> ns = measure(b, samples);
+		double med = median(ns);
+		std::printf("%-40s %12.2f %7.1f", b.name.c_str(), med,
+					med > 0.0 ? 100.0 * median_abs_deviation(ns) / med : 0.0);
+		auto base = baseline.find(b.name);
+		if (base != baseline.end())
+		{
+			double base_med = median(base->second);
+			double z = mann_whitney_z(base->second, ns);
+			const char *verdict = "";
+			if (z > kSignificantZ)
+			{
+				verdict = "slower";
+				++slower;
+			}
+			else if (z < -kSignificantZ)
+			{
+				verdict = "faster";
+				++faster;
+			}
+			std::printf(" %12.2f %+7.1f%% %s", base_med,
+						base_med > 0.0 ? 100.0 * (med / base_med - 1.0) : 0.0, verdict);
+		}
+		std::printf("\n");
+		std::fflush(stdout);
+		if (save)
+		{
+			save << b.name << " " << ns.size();
+			for (double x : ns)
+				save << " " << x;
+			save << "\n";
+		}
+	}
+	if (!baseline.empty())
+		std::printf("%d slower, %d faster at p < 0.01\n", slower, faster);
+	if (!save_path.empty() && !save)
+	{
+		std::fprintf(stderr, "Cannot write baseline %s\n", save_path.c_str());
+		return 1;
+	}
+	return 0;
+}
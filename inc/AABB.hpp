@@ -14,6 +14,9 @@ class AABB
 	AABB(const Vec3 &a, const Vec3 &b);
 
 	bool hit(const Ray &r, double tmin, double tmax) const;
+	// Slab test with the ray's reciprocal direction precomputed.
+	bool hit(const Vec3 &orig, const Vec3 &inv_dir, double tmin,
+			 double tmax) const;
 	bool intersects(const AABB &other) const;
 	bool intersects_plane(const Vec3 &point, const Vec3 &normal) const;
 	static AABB surrounding_box(const AABB &box0, const AABB &box1);
@@ -9,7 +9,7 @@
  * @param scene_path Path to the scene file.
  * @param width Desired window width.
  * @param height Desired window height.
- * @param quality Render quality (L/M/H).
+ * @param quality Render quality (L/M/C/H, C = checkerboard).
  */
 bool run_application(const std::string &scene_path, int width, int height,
                                         char quality, bool tutorial_mode,
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+// Writes level files on a background thread so saving never blocks the
+// frame loop. request() hands over a finished snapshot, the serialized
+// level text, so the writer never touches the live scene. A snapshot that
+// is still waiting when a newer one for the same file arrives is dropped,
+// so a burst of edits costs one write. Files are replaced through
+// MapSaver::write_atomic.
+class AutoSaver
+{
+        public:
+        AutoSaver() = default;
+        // Writes whatever is still pending before returning.
+        ~AutoSaver();
+        AutoSaver(const AutoSaver &) = delete;
+        AutoSaver &operator=(const AutoSaver &) = delete;
+
+        void request(const std::string &path, std::string contents);
+        // Wait until every requested snapshot is on disk. Returns the error
+        // of the last failed write since the previous report, if any.
+        std::error_code flush();
+        // Report a failed write once: true with its file and error.
+        bool take_error(std::string &path, std::error_code &ec);
+
+        private:
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::map<std::string, std::string> pending; // path => level text
+        bool writing = false;
+        bool stopping = false;
+        std::string error_path;
+        std::error_code error;
+        std::thread worker;
+
+        void run();
+};
@@ -1,10 +1,26 @@
 
 #pragma once
+#include "Frustum.hpp"
 #include "Hittable.hpp"
 #include <limits>
 #include <random>
 #include <vector>
 
+// A batch of rays traced together, with the closest hit found so far for
+// each. The buffers are kept between batches to avoid reallocating.
+struct RayBatch
+{
+	std::vector<Ray> rays;
+	std::vector<Vec3> inv_dir;
+	std::vector<HitRecord> recs;
+	std::vector<double> tmax;
+	std::vector<char> hit;
+	std::vector<int> lanes;
+	// When set, every ray starts at frustum->apex and stays inside it, so
+	// nodes outside the frustum are skipped without per-ray tests.
+	const Frustum *frustum = nullptr;
+};
+
 class BVHNode : public Hittable
 {
 	public:
@@ -19,6 +35,10 @@ class BVHNode : public Hittable
 			 HitRecord &rec) const override;
 	bool bounding_box(AABB &out) const override;
 	void query(const AABB &range, std::vector<HittablePtr> &out) const;
+	// Trace the rays listed in batch.lanes[first, first + count) through
+	// this subtree, visiting every node once for all of them.
+	void hit_batch(RayBatch &batch, double tmin, size_t first,
+				   size_t count) const;
 	bool is_bvh() const override { return true; }
 	ShapeType shape_type() const override { return ShapeType::BVH; }
 	private:
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ImageWriter.hpp"
+#include <string>
+
+/**
+ * Options of the headless `--render-all` mode.
+ */
+struct BatchOptions
+{
+        bool enabled = false;
+        std::string scenes_dir = "scenes";
+        std::string output_dir = "renders";
+        int width = 320;
+        int height = 240;
+        int threads = 0; // 0 => hardware concurrency
+        ImageFormat format = ImageFormat::Ppm;
+};
+
+/**
+ * Renders every `.toml` scene in `scenes_dir` to `output_dir/<name>.<ext>`,
+ * with the extension of `format`.
+ *
+ * All scenes are loaded first, then one pool of threads traces the rows of
+ * every image from a shared queue, so small thumbnails that cannot keep all
+ * cores busy on their own are rendered side by side. Rows stream into each
+ * image's ImageWriter as they finish, and the thread that traces an image's
+ * last row closes it while the others keep tracing.
+ *
+ * @return True when every scene loaded and every image was written.
+ */
+bool run_batch_render(const BatchOptions &options);
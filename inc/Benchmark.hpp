@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Options of the headless `--bench` mode.
+ */
+struct BenchOptions
+{
+        bool enabled = false;
+        std::string scene_path;
+        std::string path_file;   // camera/edit path; empty => built-in orbit
+        std::string output_path; // JSON report; empty => stdout
+        int frames = 120;
+        int width = 0;  // 0 => settings width scaled by quality
+        int height = 0; // 0 => settings height scaled by quality
+};
+
+/**
+ * Loads a scene and renders it without a window while replaying a camera
+ * and object-edit path, then writes frame time statistics as JSON.
+ *
+ * Path files hold one command per line, `#` starts a comment:
+ *   <frame> camera px py pz tx ty tz   camera keyframe (position, look-at),
+ *                                      interpolated between keyframes
+ *   <frame> move <index> dx dy dz      drag object, with collision
+ *   <frame> rotate <index> ax ay az deg
+ *
+ * @return True when the scene and path loaded and the report was written.
+ */
+bool run_benchmark(const BenchOptions &options);
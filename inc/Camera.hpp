@@ -1,9 +1,28 @@
 
 #pragma once
+#include "Frustum.hpp"
 #include "Ray.hpp"
 #include "Vec3.hpp"
 #include <cmath>
 
+// Image plane of one frame set up for a width x height pixel grid. The
+// direction through the centre of pixel (x, y) is corner + x * dx + y * dy,
+// so stepping to a neighbouring pixel costs one vector add.
+struct PixelGrid
+{
+	Vec3 origin;
+	Vec3 corner;
+	Vec3 dx;
+	Vec3 dy;
+
+	// Unnormalised direction through the centre of pixel (x, y).
+	Vec3 direction(int x, int y) const { return corner + dx * x + dy * y; }
+
+	// Frustum holding the rays through the pixel centres of the tile
+	// [x0, x1) x [y0, y1).
+	Frustum tile_frustum(int x0, int y0, int x1, int y1) const;
+};
+
 class Camera
 {
 	public:
@@ -20,4 +39,6 @@ class Camera
 	void move(const Vec3 &delta);
 	void rotate(double yaw, double pitch);
 	Ray ray_through(double u, double v) const;
+	// Per-frame setup matching ray_through at the pixel centres.
+	PixelGrid pixel_grid(int width, int height) const;
 };
@@ -1,5 +1,54 @@
 #pragma once
 #include "Hittable.hpp"
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
 #include <vector>
 
-bool precise_collision(const HittablePtr &a, const HittablePtr &b);
+// Exact overlap test. When `separating_axis` is given it is tried first as
+// a cheap early-out and receives the axis that separates the pair, if any.
+bool precise_collision(const HittablePtr &a, const HittablePtr &b,
+					   Vec3 *separating_axis = nullptr);
+
+// Gap left between swept shapes at contact, large enough that the boolean
+// GJK still reports the resting pair as apart. Broad phases must look this
+// far past the swept box, or a neighbour resting in the gap is missed.
+constexpr double kContactDistance = 1e-2;
+
+// Swept test: moves `moving` along `delta` and finds the first contact with
+// `other`. `toi` is the fraction of delta that can be travelled, stopping a
+// hair short of touching, and `normal` points from `moving` to `other`.
+// Shapes that already overlap report toi 0 and a zero normal.
+bool sweep_collision(const Hittable &moving, const Vec3 &delta, const Hittable &other,
+					 double &toi, Vec3 &normal);
+
+// Remembers the last separating axis of every tested pair. Objects that
+// were apart on the previous drag step are almost always still apart along
+// the same axis, which costs one support query instead of a full GJK run;
+// otherwise GJK is warm-started from that axis. Entries are only hints, so
+// stale pointers after scene edits are harmless.
+class CollisionCache
+{
+	public:
+	bool collide(const HittablePtr &a, const HittablePtr &b);
+	void clear();
+
+	private:
+	struct Key
+	{
+		const Hittable *a;
+		const Hittable *b;
+		bool operator==(const Key &o) const { return a == o.a && b == o.b; }
+	};
+	struct KeyHash
+	{
+		size_t operator()(const Key &k) const
+		{
+			size_t h = std::hash<const Hittable *>()(k.a);
+			return h ^ (std::hash<const Hittable *>()(k.b) + 0x9e3779b9 +
+						(h << 6) + (h >> 2));
+		}
+	};
+	static constexpr size_t kMaxEntries = 4096;
+	std::unordered_map<Key, Vec3, KeyHash> axes;
+};
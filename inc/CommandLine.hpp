@@ -1,10 +1,14 @@
 #pragma once
 
+#include "BatchRender.hpp"
+#include "Benchmark.hpp"
 #include <filesystem>
 #include <string>
 
 /**
- * Parses command line arguments and determines the starting scene.
+ * Parses command line arguments and determines the starting scene, or the
+ * options of the headless benchmark or batch render when the first argument
+ * is --bench or --render-all.
  *
  * @param argc Argument count.
  * @param argv Argument values.
@@ -23,3 +27,23 @@ bool is_forced_single_level_mode();
  * Returns the scene path that was provided via the command line.
  */
 const std::filesystem::path &forced_scene_path();
+
+/**
+ * Returns the options of `--bench`; `enabled` is false for normal runs.
+ */
+const BenchOptions &bench_options();
+
+/**
+ * Returns the options of `--render-all`; `enabled` is false for normal runs.
+ */
+const BatchOptions &batch_options();
+
+/**
+ * Returns the file given with `--record`, empty when input is not recorded.
+ */
+const std::string &record_path();
+
+/**
+ * Returns the file given with `--replay`, empty when input is live.
+ */
+const std::string &replay_path();
@@ -8,6 +8,8 @@
 #define OBJECT_MOUSE_SENSITIVITY 2.0
 #define OBJECT_ROTATE_SPEED 2.0
 
+#define CAMERA_COLLISION_RADIUS 0.25
+
 #define OBJECT_MIN_DIST 2.0
 #define OBJECT_MAX_DIST 10.0
 
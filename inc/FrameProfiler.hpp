@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Stages of the render_window loop that are timed separately.
+enum class ProfileStage
+{
+        Events,
+        Keyboard,
+        Goals,
+        Selection,
+        Beams,
+        Bvh,
+        Save,
+        Trace,
+        Score,
+        Convert,
+        Hud,
+        Count
+};
+
+const char *profile_stage_name(ProfileStage stage);
+
+// Per-stage timings of the last kHistory frames. Stages are timed with
+// ProfileScope and may nest (update_beams runs inside process_events, for
+// example); the per-stage numbers are self times, so the stages of one
+// frame add up to the instrumented part of it. Only the main thread may
+// open scopes.
+class FrameProfiler
+{
+        public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr int kHistory = 240;
+
+        struct Event
+        {
+                ProfileStage stage;
+                double start_us; // since the profiler was created
+                double duration_us;
+        };
+
+        struct Frame
+        {
+                double stage_ms[static_cast<int>(ProfileStage::Count)] = {};
+                double frame_ms = 0.0; // begin_frame to the next begin_frame
+                double start_us = 0.0;
+                std::vector<Event> events;
+        };
+
+        FrameProfiler();
+
+        // Close the current frame, if any, and start recording the next.
+        void begin_frame();
+        // Number of finished frames held, at most kHistory.
+        int frame_count() const { return finished; }
+        // Finished frame `age` frames back; 0 is the most recent.
+        const Frame &frame(int age) const;
+
+        // Write the held frames as Chrome trace_event JSON, viewable in
+        // chrome://tracing or Perfetto.
+        bool write_chrome_trace(const std::string &path) const;
+
+        private:
+        friend class ProfileScope;
+
+        Clock::time_point epoch;
+        Clock::time_point frame_start;
+        std::vector<Frame> ring;
+        int current = -1;
+        int finished = 0;
+        double child_ms = 0.0;
+
+        void record(ProfileStage stage, Clock::time_point start, double ms, double self_ms);
+};
+
+extern FrameProfiler g_frame_profiler;
+
+// Times the enclosing block as one stage of the current frame.
+class ProfileScope
+{
+        public:
+        explicit ProfileScope(ProfileStage stage, FrameProfiler &profiler = g_frame_profiler);
+        ~ProfileScope();
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+        private:
+        FrameProfiler &profiler;
+        ProfileStage stage;
+        FrameProfiler::Clock::time_point start;
+        double outer_child_ms;
+};
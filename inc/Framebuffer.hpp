@@ -0,0 +1,31 @@
+#pragma once
+#include "Vec3.hpp"
+#include <cstddef>
+
+// Single-precision linear colour for framebuffers: 12 bytes per pixel
+// against 24 for Vec3. Shading stays in double and is rounded on store.
+struct ColorF
+{
+	float r = 0.0f;
+	float g = 0.0f;
+	float b = 0.0f;
+
+	ColorF() = default;
+	explicit ColorF(const Vec3 &c)
+		: r(static_cast<float>(c.x)), g(static_cast<float>(c.y)),
+		  b(static_cast<float>(c.z))
+	{
+	}
+	Vec3 vec() const { return Vec3(r, g, b); }
+	ColorF &operator+=(const Vec3 &c)
+	{
+		r += static_cast<float>(c.x);
+		g += static_cast<float>(c.y);
+		b += static_cast<float>(c.z);
+		return *this;
+	}
+};
+
+// Clamp `count` colours to [0, 1] and store them as RGBA8, bytes in
+// R, G, B, A order with opaque alpha, four bytes per pixel.
+void pack_rgba8(const ColorF *src, size_t count, unsigned char *dst);
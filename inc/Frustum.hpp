@@ -0,0 +1,21 @@
+#pragma once
+#include "AABB.hpp"
+#include "Vec3.hpp"
+
+// Cone of rays leaving one apex, bounded by up to four planes through the
+// apex. A tile of primary rays uses it to skip BVH nodes none of its rays
+// can reach without testing every ray.
+class Frustum
+{
+	public:
+	Vec3 apex;
+	Vec3 normals[4]; // unit length, pointing into the frustum
+	int plane_count = 0;
+
+	// Bound the rays between four corner directions, given in order around
+	// the cone. Degenerate sides (a one pixel wide tile) are left open.
+	void set(const Vec3 &apex_, const Vec3 corners[4]);
+
+	// False only when the box lies entirely outside one of the planes.
+	bool may_overlap(const AABB &box) const;
+};
@@ -20,6 +20,9 @@ enum class ShapeType
 
 class Material;
 
+// Copied for every closer hit, so kept small: texture coordinates and the
+// beam ratio only feed colour lookups and are stored as floats, and the
+// flags share the tail padding (80 bytes instead of 104).
 class HitRecord
 {
 	public:
@@ -28,10 +31,10 @@ class HitRecord
 	double t = 0.0;
 	int object_id = -1;
 	int material_id = -1;
+	float beam_ratio = 0.0f;
+	float u = 0.0f;
+	float v = 0.0f;
 	bool front_face = false;
-	double beam_ratio = 0.0;
-	double u = 0.0;
-	double v = 0.0;
 	bool has_uv = false;
 	void set_face_normal(const Ray &r, const Vec3 &outward_normal);
 };
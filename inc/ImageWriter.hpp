@@ -0,0 +1,47 @@
+#pragma once
+#include "Vec3.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class ImageFormat
+{
+        Ppm, // binary 8-bit RGB
+        Png, // 8-bit RGB, deflate-compressed by the built-in encoder
+        Pfm  // 32-bit float RGB, unclamped, for regression diffs
+};
+
+// Format for a file name by extension: .png, .pfm, anything else PPM.
+ImageFormat image_format_for(const std::string &path);
+const char *image_extension(ImageFormat format);
+
+// Streams an image to disk while it is being rendered. Threads hand over
+// finished rows in any order and without further locking by the caller.
+// PPM and PFM rows have a fixed size, so they are converted straight into
+// a memory-mapped file (or one whole-file buffer where mapping fails) at
+// their final offset. PNG rows are filtered and compressed in order: rows
+// that arrive early wait until the rows above them are in, and whichever
+// thread completes the run encodes it.
+class ImageWriter
+{
+        public:
+        ImageWriter();
+        ~ImageWriter();
+        ImageWriter(const ImageWriter &) = delete;
+        ImageWriter &operator=(const ImageWriter &) = delete;
+
+        bool open(const std::string &path, int width, int height);
+        bool open(const std::string &path, int width, int height, ImageFormat format);
+        // Hand over rows [y, y + rows); PPM and PNG clamp colours to [0, 1].
+        void write_rows(int y, const Vec3 *pixels, int rows);
+        // Finish the file. False if a write failed or rows are missing.
+        bool close();
+
+        private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+};
+
+// Write a whole width x height image in one call.
+bool write_image(const std::string &path, const std::vector<Vec3> &pixels, int width,
+                 int height);
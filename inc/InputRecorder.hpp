@@ -0,0 +1,75 @@
+#pragma once
+#include <SDL.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Records what the game loop reads from SDL (each frame's dt, the keyboard
+// state and the polled events) to a compact binary file, or feeds such a
+// file back instead of live input. A replay runs every frame with the
+// recorded dt, so the same scene sees the same edits and camera path on
+// any build and the frame timings can be compared one for one.
+//
+// Only the game loop goes through the recorder; menus opened during a
+// session (pause, level finished) still read live input.
+class InputRecorder
+{
+        public:
+        enum class Mode
+        {
+                Off,
+                Record,
+                Replay
+        };
+
+        // Window size and quality the session ran at, stored in the header.
+        struct Header
+        {
+                int width = 0;
+                int height = 0;
+                char quality = 'H';
+        };
+
+        bool start_recording(const std::string &path, const Header &header);
+        bool start_replay(const std::string &path);
+        // Flush a recording, or print the timing summary of a replay.
+        void finish();
+
+        Mode mode() const { return current_mode; }
+        bool active() const { return current_mode != Mode::Off; }
+        const Header &header() const { return file_header; }
+
+        // Start the next frame. Records dt, or replaces it with the recorded
+        // value; false once a replay has no frames left.
+        bool begin_frame(double &dt);
+        // Trace time of the frame just rendered, summarised by finish().
+        void end_frame(double trace_ms);
+        // Stand-ins for SDL_PollEvent and SDL_GetKeyboardState.
+        bool poll_event(SDL_Event &e);
+        const Uint8 *keyboard_state();
+
+        private:
+        struct Frame
+        {
+                double dt = 0.0;
+                std::vector<std::uint16_t> keys;
+                std::vector<SDL_Event> events;
+        };
+
+        Mode current_mode = Mode::Off;
+        Header file_header;
+        std::string file_path;
+        std::ofstream out;
+        std::ifstream in;
+        Frame frame;
+        bool frame_open = false;
+        size_t next_event = 0;
+        Uint8 keys[SDL_NUM_SCANCODES] = {};
+        std::vector<double> trace_ms;
+
+        void write_frame();
+        bool read_frame();
+};
+
+extern InputRecorder g_input_recorder;
@@ -0,0 +1,46 @@
+#pragma once
+#include "AABB.hpp"
+#include "light.hpp"
+#include <vector>
+
+// Uniform world-space grid over the volumes lights can reach. Each cell
+// lists, in scene order, the lights whose bounds overlap it; lights without
+// a finite range are listed everywhere. Rebuilt once per frame, together
+// with the prepared shading data of every light.
+class LightGrid
+{
+        public:
+        struct LightList
+        {
+                const int *first;
+                const int *last;
+                const int *begin() const { return first; }
+                const int *end() const { return last; }
+        };
+
+        void build(const std::vector<PointLight> &lights);
+
+        // Indices of the lights that may light point p.
+        LightList lights_at(const Vec3 &p) const;
+
+        // Cell containing p, or -1 outside the grid.
+        int cell_of(const Vec3 &p) const;
+
+        const PreparedLight &light(int index) const { return prepared[index]; }
+
+        // Conservative box around everything light L can illuminate.
+        static bool light_bounds(const PointLight &L, AABB &out);
+
+        private:
+        AABB bounds;
+        Vec3 inv_cell;
+        int nx = 0;
+        int ny = 0;
+        int nz = 0;
+        std::vector<PreparedLight> prepared;
+        std::vector<int> global_lights;
+        std::vector<int> cell_start;
+        std::vector<int> cell_lights;
+
+        void cell_range(const AABB &box, int lo[3], int hi[3]) const;
+};
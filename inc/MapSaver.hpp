@@ -5,12 +5,26 @@
 #include "material.hpp"
 
 #include <string>
+#include <system_error>
 #include <vector>
 
 class MapSaver
 {
         public:
+        // Write the scene as a level file. The file is replaced atomically,
+        // so a crash leaves either the old level or the new one.
         static bool save(const std::string &path, const Scene &scene,
                                          const Camera &camera,
                                          const std::vector<Material> &materials);
+        static bool save(const std::string &path, const Scene &scene, const Camera &camera,
+                         const std::vector<Material> &materials, std::error_code &ec);
+
+        // Level file text of the scene, as save would write it.
+        static std::string serialize(const Scene &scene, const Camera &camera,
+                                     const std::vector<Material> &materials);
+
+        // Write contents to path + ".tmp", flush it to disk and rename it
+        // over path.
+        static bool write_atomic(const std::string &path, const std::string &contents,
+                                 std::error_code &ec);
 };
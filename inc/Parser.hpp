@@ -8,6 +8,8 @@
 class Parser
 {
 	public:
+	// Loads the level's .rtbin snapshot instead when it is up to date, and
+	// writes a fresh one after parsing otherwise (see SceneCache.hpp).
 	static bool parse_rt_file(const std::string &path, Scene &outScene,
 							  Camera &outCamera, int width, int height);
 
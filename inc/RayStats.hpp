@@ -0,0 +1,87 @@
+#pragma once
+#include "Hittable.hpp"
+#include <ostream>
+
+// Ray statistics, compiled in with -DMINIRT_RAY_STATS=ON. Every thread
+// counts into its own block; flush() adds the block to the frame totals
+// with atomic adds, so counting never takes a lock. When compiled out the
+// counting functions are empty and the hooks cost nothing.
+
+enum class RayKind
+{
+	Primary,
+	Shadow,
+	Mirror,
+	Transparency,
+	Beam,
+	Score,
+	Count
+};
+
+static constexpr int kRayKinds = static_cast<int>(RayKind::Count);
+static constexpr int kShapeTypes = static_cast<int>(ShapeType::BeamTarget) + 1;
+
+struct RayCounters
+{
+	unsigned long long rays[kRayKinds] = {};
+	unsigned long long nodes = 0;	  // BVH nodes entered
+	unsigned long long box_tests = 0; // ray-box tests in BVH nodes
+	unsigned long long primitive_tests[kShapeTypes] = {};
+
+	unsigned long long total_rays() const;
+	unsigned long long total_primitive_tests() const;
+	RayCounters &operator+=(const RayCounters &o);
+
+	// One CSV row per frame: the header names the columns of write_csv.
+	static void write_csv_header(std::ostream &out);
+	void write_csv(std::ostream &out, int frame) const;
+	// JSON object with the counters by name.
+	void write_json(std::ostream &out) const;
+};
+
+const char *ray_kind_name(RayKind kind);
+const char *shape_type_name(ShapeType type);
+
+namespace ray_stats
+{
+
+#ifdef MINIRT_RAY_STATS
+inline constexpr bool kEnabled = true;
+
+inline thread_local RayCounters local;
+
+inline void count_ray(RayKind kind, unsigned long long n = 1)
+{
+	local.rays[static_cast<int>(kind)] += n;
+}
+
+inline void count_node(unsigned long long box_tests)
+{
+	++local.nodes;
+	local.box_tests += box_tests;
+}
+
+// Counts n tests against h unless h is an inner BVH node.
+inline void count_primitive(const Hittable &h, unsigned long long n = 1)
+{
+	if (!h.is_bvh())
+		local.primitive_tests[static_cast<int>(h.shape_type())] += n;
+}
+
+// Add this thread's counts to the frame totals and clear them.
+void flush();
+// Clear the frame totals.
+void begin_frame();
+RayCounters frame_totals();
+#else
+inline constexpr bool kEnabled = false;
+
+inline void count_ray(RayKind, unsigned long long = 1) {}
+inline void count_node(unsigned long long) {}
+inline void count_primitive(const Hittable &, unsigned long long = 1) {}
+inline void flush() {}
+inline void begin_frame() {}
+inline RayCounters frame_totals() { return RayCounters(); }
+#endif
+
+} // namespace ray_stats
@@ -1,7 +1,11 @@
 #pragma once
 #include "Camera.hpp"
+#include "Framebuffer.hpp"
+#include "LightGrid.hpp"
+#include "RayStats.hpp"
 #include "Scene.hpp"
 #include "material.hpp"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -19,18 +23,47 @@ class RenderSettings
 	float downscale = 1.0f; // 1.0 => full res, 1.5 => medium, 2.0 => low
 };
 
+// Timings of one headless frame, see Renderer::render_offscreen.
+struct FrameTiming
+{
+	double trace_ms = 0.0;
+	double score_ms = 0.0;
+	long long rays = 0; // camera and bounce rays, not shadow rays
+	RayCounters counters; // zero unless built with MINIRT_RAY_STATS
+};
+
+// Per-image state of an offline render, set up once by
+// Renderer::prepare_offline and shared by every thread tracing its rows.
+struct OfflineFrame
+{
+	int width = 0;
+	int height = 0;
+	PixelGrid grid;
+	LightGrid light_grid;
+};
+
 class Renderer
 {
 	public:
 	Renderer(Scene &s, Camera &c);
+	~Renderer();
+        // Format follows the extension of path: .png, .pfm or PPM.
         void render_ppm(const std::string &path, const std::vector<Material> &mats,
                                         const RenderSettings &rset);
+        // Offline rendering in row ranges, so one pool of threads can work
+        // on several images at once. trace_rows is safe to call concurrently.
+        void prepare_offline(OfflineFrame &frame, int width, int height) const;
+        void trace_rows(const OfflineFrame &frame, int y_begin, int y_end,
+                        const std::vector<Material> &mats, Vec3 *out) const;
         bool render_window(std::vector<Material> &mats, const RenderSettings &rset,
                                            const std::string &scene_path, bool tutorial_mode,
                                            GameSession *session);
+        FrameTiming render_offscreen(std::vector<ColorF> &framebuffer, int RW, int RH,
+                                     int T, std::vector<Material> &mats);
 		struct RenderState;
         private:
         void mark_scene_dirty(RenderState &st);
+        void refresh_scene(std::vector<Material> &mats);
         bool init_sdl(SDL_Window *&win, SDL_Renderer *&ren, SDL_Texture *&tex,
                                        int W, int H, int RW, int RH);
         void process_events(RenderState &st, SDL_Window *win, SDL_Renderer *ren,
@@ -40,11 +73,14 @@ class Renderer
                                                std::vector<Material> &mats);
         void update_selection(RenderState &st, std::vector<Material> &mats);
         void render_frame(RenderState &st, SDL_Renderer *ren, SDL_Texture *tex,
-                                          std::vector<Vec3> &framebuffer,
+                                          std::vector<ColorF> &framebuffer,
                                           std::vector<unsigned char> &pixels, int RW,
                                           int RH, int W, int H, int T,
                                           std::vector<Material> &mats);
+        long long trace_frame(RenderState &st, std::vector<ColorF> &framebuffer, int RW,
+                              int RH, int T, const std::vector<Material> &mats);
         int render_hud(const RenderState &st, SDL_Renderer *ren, int W, int H);
         Scene &scene;
         Camera &cam;
+        std::unique_ptr<RenderState> offscreen;
 };
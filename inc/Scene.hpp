@@ -1,6 +1,8 @@
 #pragma once
 #include "BVH.hpp"
+#include "Collision.hpp"
 #include "Hittable.hpp"
+#include "SpatialHash.hpp"
 #include "light.hpp"
 #include "material.hpp"
 #include <memory>
@@ -21,6 +23,13 @@ class Scene
         bool target_required = false;
         double minimal_score = 0.0;
         std::vector<std::string> prompts;
+        // Bumped by build_bvh so callers can detect geometry edits cheaply.
+        unsigned long geometry_revision = 0;
+        // Separating axes from earlier collides() calls, see CollisionCache.
+        mutable CollisionCache collision_cache;
+        // Object boxes for neighbour queries; kept current while objects
+        // move, whereas the BVH is only refreshed by build_bvh.
+        SpatialHash spatial;
 
         // Update beam objects and associated lights in the scene.
         void update_beams(const std::vector<Material> &materials);
@@ -34,19 +43,30 @@ class Scene
 	// Test a ray against all objects.
 	bool hit(const Ray &r, double tmin, double tmax, HitRecord &rec) const;
 
+	// Closest hit for every ray in batch.rays; batch.hit[i] tells whether
+	// batch.recs[i] is valid. Gives the same hits as calling hit per ray.
+	void hit_batch(RayBatch &batch, double tmin, double tmax) const;
+
 	// Determine whether object at index collides with others.
 	bool collides(int index) const;
 
 	// Move object while preventing collisions.
 	Vec3 move_with_collision(int index, const Vec3 &delta);
 
+	// Rotate object at index about axis, keeping the spatial hash current.
+	void rotate_object(int index, const Vec3 &axis, double angle);
+
 	// Move camera while avoiding obstacles.
         Vec3 move_camera(Camera &cam, const Vec3 &delta,
                                          const std::vector<Material> &materials) const;
         private:
+        void query_neighbours(const AABB &range, std::vector<HittablePtr> &out) const;
         bool is_movable(int index) const;
         void apply_translation(const HittablePtr &object, const Vec3 &delta);
-        void attempt_axis_move(int index, const Vec3 &axis_delta, Vec3 &moved);
+        bool sweep(int index, const Vec3 &delta, double &toi, Vec3 &normal);
+        bool sweep_camera(const Vec3 &origin, const Vec3 &delta,
+                          const std::vector<Material> &mats, double &toi,
+                          Vec3 &normal) const;
         void prepare_beam_roots(std::vector<std::shared_ptr<Laser>> &roots,
                                                         std::unordered_map<int, int> &id_map);
         void process_beams(const std::vector<Material> &mats,
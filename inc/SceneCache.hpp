@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * One validated table of a level file: everything the parser builds its
+ * objects, materials and lights from. Fields a table does not use are zero.
+ * Records are plain data so the cache can store them as they are in memory.
+ */
+struct SceneRecord
+{
+        enum Kind : uint8_t
+        {
+                Camera,
+                Ambient,
+                Light,
+                Plane,
+                Sphere,
+                Cube,
+                Cylinder,
+                Cone,
+                BeamSource,
+                BeamTarget,
+                Quota
+        };
+        enum Flag : uint8_t
+        {
+                Reflective = 1 << 0,
+                Transparent = 1 << 1,
+                Rotatable = 1 << 2,
+                Movable = 1 << 3,
+                Scorable = 1 << 4,
+                WithLaser = 1 << 5,
+                TargetRequired = 1 << 6
+        };
+
+        uint8_t kind = Camera;
+        uint8_t flags = 0;
+        uint8_t rgb[3] = {0, 0, 0};
+        uint8_t pad[3] = {0, 0, 0};
+        double position[3] = {0, 0, 0};
+        double dir[3] = {0, 0, 0};
+        // camera: fov; ambient/light: intensity; sphere: radius;
+        // cube: length, width, height; cylinder/cone: radius, height;
+        // beam source: intensity, radius, length; beam target: radius;
+        // quota: minimal score.
+        double a = 0.0;
+        double b = 0.0;
+        double c = 0.0;
+
+        bool has(Flag flag) const { return (flags & flag) != 0; }
+};
+
+/**
+ * A whole level in file order, as checked by the parser.
+ */
+struct SceneSnapshot
+{
+        std::vector<SceneRecord> records;
+        std::vector<std::string> prompts;
+};
+
+/**
+ * Identifies the version of a level file a cache was made from.
+ */
+struct SceneSourceStamp
+{
+        uint64_t size = 0;
+        int64_t mtime = 0;
+};
+
+/**
+ * Binary snapshot of a parsed level, kept next to it as `<name>.rtbin`.
+ *
+ * The file is a fixed header (magic, format version, record size, the
+ * stamp of the source file and a checksum), the records exactly as they
+ * lie in memory, then the prompts as length-prefixed strings. Loading maps
+ * the file and copies the records out in one go, with no text to scan.
+ * A cache whose stamp does not match the level file any more, or that fails
+ * any header check, is ignored and rewritten by the next parse.
+ */
+namespace scene_cache
+{
+
+std::string path_for(const std::string &scene_path);
+
+// False when the level file cannot be inspected.
+bool stamp(const std::string &scene_path, SceneSourceStamp &out);
+
+// True when a cache for exactly this version of the level was loaded.
+bool load(const std::string &scene_path, const SceneSourceStamp &source, SceneSnapshot &out);
+
+// Best effort: a level in a read-only directory just stays uncached.
+bool save(const std::string &scene_path, const SceneSourceStamp &source,
+          const SceneSnapshot &snapshot);
+
+} // namespace scene_cache
@@ -2,10 +2,12 @@
 #include <string>
 
 struct GameSettings {
-    char quality;            // 'L', 'M', or 'H'
+    char quality;            // 'L', 'M', 'C' (checkerboard) or 'H'
     float mouse_sensitivity; // multiplier applied to base sensitivity
     int width;               // window width
     int height;              // window height
+    int target_fps;          // dynamic resolution target, 0 => fixed quality
+    bool foveated;           // full density near the crosshair only
 };
 
 extern GameSettings g_settings;
@@ -0,0 +1,32 @@
+#pragma once
+#include "Hittable.hpp"
+#include "Scene.hpp"
+#include "light.hpp"
+#include "material.hpp"
+#include <vector>
+
+// Surface shading and beam scoring. Kept apart from the renderer so the
+// kernels can be built and benchmarked without SDL.
+
+Vec3 brighten_color(const Vec3 &color);
+Vec3 darken_color(const Vec3 &color);
+double luminance(const Vec3 &c);
+
+// Colour of the surface at rec, with plane and checkered patterns applied.
+// use_base_state ignores highlight colours and checkering.
+Vec3 surface_color_at(const Scene &scene, const HitRecord &rec, const Material &mat,
+                      bool use_base_state = false);
+double compute_effective_alpha(const Material &mat, const HitRecord &rec);
+Vec3 ambient_contribution(const Scene &scene, const Vec3 &surface_color);
+// Diffuse and specular light from one light at point, shadow rays included.
+Vec3 light_contribution(const Scene &scene, const std::vector<Material> &mats,
+                        const PreparedLight &light, const HitRecord &rec,
+                        const Vec3 &surface_color, const Material &mat, const Vec3 &point,
+                        const Vec3 &view_dir);
+
+// Lit area the beam spotlight L adds to scorable surfaces.
+double integrate_spotlight_area(const Scene &scene, const std::vector<Material> &mats,
+                                const PointLight &L);
+double compute_beam_score(const Scene &scene, const std::vector<Material> &mats);
+double compute_object_beam_score(const Scene &scene, const std::vector<Material> &mats,
+                                 int object_id);
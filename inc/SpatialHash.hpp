@@ -0,0 +1,58 @@
+#pragma once
+#include "Hittable.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Loose uniform grid over object bounding boxes, hashed by cell so it has
+// no fixed extent. Unlike the BVH it can follow a moving object cheaply:
+// update() only touches the hash when the object's box crosses into other
+// cells. Objects without a finite box (planes) are not stored. Queries
+// reuse internal scratch, so one hash must not be queried from several
+// threads at once.
+class SpatialHash
+{
+	public:
+	// Make the hash hold exactly `objects`, updating entries that are
+	// already present and dropping those that are gone. The cell size is
+	// chosen afresh when none of the stored objects is kept.
+	void sync(const std::vector<HittablePtr> &objects);
+
+	// Refresh the box of an object after it moved or rotated.
+	void update(const Hittable *object);
+
+	// Every stored object whose box overlaps range, each once.
+	void query(const AABB &range, std::vector<HittablePtr> &out) const;
+
+	void clear();
+	bool empty() const { return slot_of.empty(); }
+
+	private:
+	struct Entry
+	{
+		HittablePtr object;
+		AABB box;
+		int lo[3] = {0, 0, 0};
+		int hi[3] = {-1, -1, -1};
+		bool large = false;
+		unsigned stamp = 0;
+		bool alive = false;
+	};
+
+	double cell_size = 0.0;
+	double inv_cell = 0.0;
+	std::vector<Entry> entries;
+	std::vector<int> free_slots;
+	std::vector<int> large_entries;
+	std::unordered_map<const Hittable *, int> slot_of;
+	std::unordered_map<std::uint64_t, std::vector<int>> cells;
+	mutable std::vector<unsigned> seen;
+	mutable unsigned query_stamp = 0;
+	unsigned sync_stamp = 0;
+
+	void choose_cell_size(const std::vector<HittablePtr> &objects);
+	void cell_range(const AABB &box, int lo[3], int hi[3]) const;
+	void link(int slot);
+	void unlink(int slot);
+	void place(int slot);
+};
@@ -26,6 +26,26 @@ class PointLight
                            double spot_radius = -1.0);
 };
 
+// Per-frame copy of a light with the values shading needs every hit
+// precomputed, so the inner loop does no normalisation or division.
+struct PreparedLight
+{
+        const PointLight *source;
+        Vec3 position;
+        Vec3 direction;    // as stored, used by the cone test
+        Vec3 axis;         // normalised direction
+        Vec3 color;
+        Vec3 radiance;     // color * intensity
+        double intensity;
+        double cutoff_cos;
+        double inv_range;  // 0 when the light has no range
+        double radius_sq;  // beam spotlights only
+        bool beam;         // beam spotlight with a usable axis and radius
+        bool has_axis;
+};
+
+PreparedLight prepare_light(const PointLight &L);
+
 class Ambient
 {
 	public:
@@ -20,6 +20,10 @@ class Material
         bool checkered = false; // render as checkered pattern when true
 };
 
+// pow(base, exponent) for specular lobes. Whole exponents use repeated
+// squaring; anything else falls back to std::pow.
+double specular_power(double base, double exponent);
+
 Vec3 phong(const Material &m, const Ambient &ambient,
 		   const std::vector<PointLight> &lights, const Vec3 &p, const Vec3 &n,
 		   const Vec3 &eye);
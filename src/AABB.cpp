@@ -31,6 +31,31 @@ bool AABB::hit(const Ray &r, double tmin, double tmax) const
 	return true;
 }
 
+bool AABB::hit(const Vec3 &orig, const Vec3 &inv_dir, double tmin,
+			   double tmax) const
+{
+	const double o[3] = {orig.x, orig.y, orig.z};
+	const double inv[3] = {inv_dir.x, inv_dir.y, inv_dir.z};
+	const double lo[3] = {min.x, min.y, min.z};
+	const double hi[3] = {max.x, max.y, max.z};
+	for (int a = 0; a < 3; ++a)
+	{
+		double t0 = (lo[a] - o[a]) * inv[a];
+		double t1 = (hi[a] - o[a]) * inv[a];
+		if (inv[a] < 0.0)
+		{
+			std::swap(t0, t1);
+		}
+		tmin = t0 > tmin ? t0 : tmin;
+		tmax = t1 < tmax ? t1 : tmax;
+		if (tmax <= tmin)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 bool AABB::intersects(const AABB &other) const
 {
 	return (max.x > other.min.x && min.x < other.max.x && max.y > other.min.y &&
@@ -0,0 +1,77 @@
+#include "AutoSaver.hpp"
+#include "MapSaver.hpp"
+#include <utility>
+
+AutoSaver::~AutoSaver()
+{
+        {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+        }
+        wake.notify_one();
+        if (worker.joinable())
+                worker.join();
+}
+
+void AutoSaver::request(const std::string &path, std::string contents)
+{
+        {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending[path] = std::move(contents);
+                // Started on first use, so renderers that never save do not
+                // keep an idle thread.
+                if (!worker.joinable())
+                        worker = std::thread(&AutoSaver::run, this);
+        }
+        wake.notify_one();
+}
+
+std::error_code AutoSaver::flush()
+{
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending.empty() && !writing; });
+        std::error_code ec = error;
+        error.clear();
+        error_path.clear();
+        return ec;
+}
+
+bool AutoSaver::take_error(std::string &path, std::error_code &ec)
+{
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+                return false;
+        path = error_path;
+        ec = error;
+        error.clear();
+        error_path.clear();
+        return true;
+}
+
+void AutoSaver::run()
+{
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+                wake.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty())
+                        return; // stopping, with nothing left to write
+                auto next = pending.begin();
+                std::string path = next->first;
+                std::string contents = std::move(next->second);
+                pending.erase(next);
+                writing = true;
+                lock.unlock();
+                std::error_code ec;
+                MapSaver::write_atomic(path, contents, ec);
+                lock.lock();
+                writing = false;
+                if (ec)
+                {
+                        error = ec;
+                        error_path = path;
+                }
+                if (pending.empty())
+                        idle.notify_all();
+        }
+}
@@ -1,4 +1,5 @@
 #include "BVH.hpp"
+#include "RayStats.hpp"
 #include <algorithm>
 
 BVHNode::BVHNode() {}
@@ -52,15 +53,67 @@ BVHNode::BVHNode(std::vector<HittablePtr> &objects, size_t start, size_t end)
 
 bool BVHNode::hit(const Ray &r, double tmin, double tmax, HitRecord &rec) const
 {
+	ray_stats::count_node(1);
 	if (!box.hit(r, tmin, tmax))
 	{
 		return false;
 	}
+	ray_stats::count_primitive(*left);
+	ray_stats::count_primitive(*right);
 	bool hitLeft = left->hit(r, tmin, tmax, rec);
 	bool hitRight = right->hit(r, tmin, hitLeft ? rec.t : tmax, rec);
 	return hitLeft || hitRight;
 }
 
+void BVHNode::hit_batch(RayBatch &batch, double tmin, size_t first,
+						size_t count) const
+{
+	// Surviving lanes are appended after the caller's list; indices are
+	// used instead of pointers because children append more.
+	if (batch.frustum && !batch.frustum->may_overlap(box))
+	{
+		return;
+	}
+	ray_stats::count_node(count);
+	size_t base = batch.lanes.size();
+	for (size_t k = 0; k < count; ++k)
+	{
+		int lane = batch.lanes[first + k];
+		if (box.hit(batch.rays[lane].orig, batch.inv_dir[lane], tmin,
+					batch.tmax[lane]))
+		{
+			batch.lanes.push_back(lane);
+		}
+	}
+	size_t active = batch.lanes.size() - base;
+	if (active == 0)
+	{
+		return;
+	}
+	const Hittable *children[2] = {left.get(), right.get()};
+	for (const Hittable *child : children)
+	{
+		if (child->is_bvh())
+		{
+			static_cast<const BVHNode *>(child)->hit_batch(batch, tmin, base,
+														  active);
+			continue;
+		}
+		ray_stats::count_primitive(*child, active);
+		for (size_t k = 0; k < active; ++k)
+		{
+			int lane = batch.lanes[base + k];
+			if (child->hit(batch.rays[lane], tmin, batch.tmax[lane],
+						   batch.recs[lane]))
+			{
+				batch.tmax[lane] = batch.recs[lane].t;
+				batch.hit[lane] = 1;
+			}
+		}
+	}
+	batch.lanes.resize(base);
+}
+
 bool BVHNode::bounding_box(AABB &out) const
 {
 	out = box;
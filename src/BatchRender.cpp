@@ -0,0 +1,164 @@
+#include "BatchRender.hpp"
+#include "Camera.hpp"
+#include "ImageWriter.hpp"
+#include "Parser.hpp"
+#include "RayStats.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct BatchJob
+{
+        std::string scene_path;
+        std::string image_path;
+        Scene scene;
+        Camera cam{{0, 0, -10}, {0, 0, 0}, 60.0, 1.0};
+        std::vector<Material> mats;
+        std::unique_ptr<Renderer> renderer;
+        OfflineFrame frame;
+        ImageWriter writer;
+        int first_row = 0; // index of row 0 in the shared row queue
+        std::atomic<int> rows_left{0};
+        double done_ms = 0.0;
+        bool written = false;
+};
+
+std::vector<std::filesystem::path> list_scenes(const std::string &dir)
+{
+        namespace fs = std::filesystem;
+        std::vector<fs::path> scenes;
+        std::error_code ec;
+        for (auto &entry : fs::directory_iterator(dir, ec))
+        {
+                if (ec)
+                        break;
+                if (entry.is_regular_file(ec) && entry.path().extension() == ".toml")
+                        scenes.push_back(entry.path());
+        }
+        std::sort(scenes.begin(), scenes.end());
+        return scenes;
+}
+
+} // namespace
+
+bool run_batch_render(const BatchOptions &options)
+{
+        namespace fs = std::filesystem;
+        std::vector<fs::path> scenes = list_scenes(options.scenes_dir);
+        if (scenes.empty())
+        {
+                std::cerr << "No scenes found in " << options.scenes_dir << "\n";
+                return false;
+        }
+        std::error_code ec;
+        fs::create_directories(options.output_dir, ec);
+        if (ec)
+        {
+                std::cerr << "Failed to create " << options.output_dir << ": " << ec.message()
+                          << "\n";
+                return false;
+        }
+
+        auto start = Clock::now();
+        const int W = options.width;
+        const int H = options.height;
+        bool ok = true;
+        // The parser keeps its materials in shared storage, so scenes are
+        // loaded one after another; only the tracing runs in parallel.
+        std::vector<std::unique_ptr<BatchJob>> jobs;
+        int total_rows = 0;
+        for (const fs::path &path : scenes)
+        {
+                auto job = std::make_unique<BatchJob>();
+                job->scene_path = path.string();
+                job->image_path = (fs::path(options.output_dir) / path.stem()).string() +
+                                  image_extension(options.format);
+                if (!Parser::parse_rt_file(job->scene_path, job->scene, job->cam, W, H))
+                {
+                        std::cerr << "Failed to parse scene: " << job->scene_path << "\n";
+                        ok = false;
+                        continue;
+                }
+                job->cam.aspect = static_cast<double>(W) / H;
+                job->mats = Parser::get_materials();
+                job->scene.update_beams(job->mats);
+                job->scene.build_bvh();
+                job->renderer = std::make_unique<Renderer>(job->scene, job->cam);
+                job->renderer->prepare_offline(job->frame, W, H);
+                if (!job->writer.open(job->image_path, W, H, options.format))
+                {
+                        std::cerr << "Failed to open image: " << job->image_path << "\n";
+                        ok = false;
+                        continue;
+                }
+                job->first_row = total_rows;
+                job->rows_left = H;
+                total_rows += H;
+                jobs.push_back(std::move(job));
+        }
+        double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::atomic<int> next_row{0};
+        auto worker = [&]()
+        {
+                std::vector<Vec3> pixels(W);
+                for (;;)
+                {
+                        int row = next_row.fetch_add(1);
+                        if (row >= total_rows)
+                                break;
+                        BatchJob &job = *jobs[row / H];
+                        int y = row - job.first_row;
+                        job.renderer->trace_rows(job.frame, y, y + 1, job.mats, pixels.data());
+                        job.writer.write_rows(y, pixels.data(), 1);
+                        if (job.rows_left.fetch_sub(1) != 1)
+                                continue;
+                        job.written = job.writer.close();
+                        job.done_ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                                                start)
+                                              .count();
+                }
+                ray_stats::flush();
+        };
+
+        int T = options.threads > 0 ? options.threads
+                                    : static_cast<int>(std::thread::hardware_concurrency());
+        if (T <= 0)
+                T = 8;
+        std::vector<std::thread> pool;
+        pool.reserve(T);
+        for (int i = 0; i < T; ++i)
+                pool.emplace_back(worker);
+        for (auto &th : pool)
+                th.join();
+
+        for (const auto &job : jobs)
+        {
+                if (!job->written)
+                {
+                        std::cerr << "Failed to write image: " << job->image_path << "\n";
+                        ok = false;
+                        continue;
+                }
+                std::cout << job->scene_path << " -> " << job->image_path << " (done at "
+                          << static_cast<int>(job->done_ms) << " ms)\n";
+        }
+        double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << "Rendered " << jobs.size() << " scenes at " << W << "x" << H << " with " << T
+                  << " threads in " << static_cast<int>(total_ms) << " ms (loading "
+                  << static_cast<int>(load_ms) << " ms)\n";
+        return ok;
+}
@@ -0,0 +1,301 @@
+#include "Benchmark.hpp"
+#include "Camera.hpp"
+#include "Parser.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+#include "Settings.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct CameraKey
+{
+        int frame = 0;
+        Vec3 position;
+        Vec3 target;
+};
+
+struct ObjectEdit
+{
+        int frame = 0;
+        bool rotate = false;
+        int index = -1;
+        Vec3 vector;
+        double degrees = 0.0;
+};
+
+struct BenchPath
+{
+        std::vector<CameraKey> keys;
+        std::vector<ObjectEdit> edits;
+};
+
+bool load_path(const std::string &file, BenchPath &path)
+{
+        std::ifstream in(file);
+        if (!in)
+        {
+                std::cerr << "Failed to open bench path: " << file << "\n";
+                return false;
+        }
+        std::string line;
+        int line_number = 0;
+        while (std::getline(in, line))
+        {
+                ++line_number;
+                size_t comment = line.find('#');
+                if (comment != std::string::npos)
+                        line.erase(comment);
+                if (line.find_first_not_of(" \t\r") == std::string::npos)
+                        continue;
+                std::istringstream ss(line);
+                int frame = 0;
+                std::string command;
+                bool ok = static_cast<bool>(ss >> frame >> command) && frame >= 0;
+                if (ok && command == "camera")
+                {
+                        CameraKey key;
+                        key.frame = frame;
+                        ok = static_cast<bool>(ss >> key.position.x >> key.position.y >>
+                                               key.position.z >> key.target.x >>
+                                               key.target.y >> key.target.z);
+                        if (ok)
+                                path.keys.push_back(key);
+                }
+                else if (ok && (command == "move" || command == "rotate"))
+                {
+                        ObjectEdit edit;
+                        edit.frame = frame;
+                        edit.rotate = command == "rotate";
+                        ok = static_cast<bool>(ss >> edit.index >> edit.vector.x >>
+                                               edit.vector.y >> edit.vector.z);
+                        if (ok && edit.rotate)
+                                ok = static_cast<bool>(ss >> edit.degrees);
+                        if (ok)
+                                path.edits.push_back(edit);
+                }
+                else
+                {
+                        ok = false;
+                }
+                if (!ok)
+                {
+                        std::cerr << file << ":" << line_number << ": invalid path command\n";
+                        return false;
+                }
+        }
+        auto by_frame = [](const auto &a, const auto &b) { return a.frame < b.frame; };
+        std::stable_sort(path.keys.begin(), path.keys.end(), by_frame);
+        std::stable_sort(path.edits.begin(), path.edits.end(), by_frame);
+        return true;
+}
+
+/// Built-in path: one orbit around the point the camera looks at, while the
+/// first movable object is pushed back and forth.
+BenchPath default_path(const Scene &scene, const Camera &cam, int frames)
+{
+        BenchPath path;
+        double distance = 10.0;
+        HitRecord rec;
+        if (scene.hit(Ray(cam.origin, cam.forward), 1e-4, 1e9, rec))
+                distance = rec.t;
+        Vec3 pivot = cam.origin + cam.forward * distance;
+        Vec3 offset = cam.origin - pivot;
+        const int kKeys = 16;
+        for (int k = 0; k <= kKeys; ++k)
+        {
+                double angle = 2.0 * M_PI * k / kKeys;
+                double c = std::cos(angle);
+                double s = std::sin(angle);
+                CameraKey key;
+                key.frame = frames * k / kKeys;
+                key.position = pivot + Vec3(offset.x * c - offset.z * s, offset.y,
+                                            offset.x * s + offset.z * c);
+                key.target = pivot;
+                path.keys.push_back(key);
+        }
+        for (size_t i = 0; i < scene.objects.size(); ++i)
+        {
+                if (!scene.objects[i]->movable || scene.objects[i]->is_beam())
+                        continue;
+                for (int f = 0; f < frames; f += 4)
+                {
+                        ObjectEdit edit;
+                        edit.frame = f;
+                        edit.index = static_cast<int>(i);
+                        edit.vector = Vec3((f / 16) % 2 ? -0.25 : 0.25, 0.0, 0.0);
+                        path.edits.push_back(edit);
+                }
+                break;
+        }
+        return path;
+}
+
+void place_camera(const BenchPath &path, int frame, Camera &cam)
+{
+        if (path.keys.empty())
+                return;
+        auto next = std::upper_bound(path.keys.begin(), path.keys.end(), frame,
+                                     [](int f, const CameraKey &k) { return f < k.frame; });
+        const CameraKey &a = next == path.keys.begin() ? *next : *(next - 1);
+        const CameraKey &b = next == path.keys.end() ? a : *next;
+        double t = b.frame > a.frame ? static_cast<double>(frame - a.frame) / (b.frame - a.frame)
+                                     : 0.0;
+        t = std::clamp(t, 0.0, 1.0);
+        Vec3 position = a.position + (b.position - a.position) * t;
+        Vec3 target = a.target + (b.target - a.target) * t;
+        if ((target - position).length_squared() <= 1e-12)
+                return;
+        cam = Camera(position, target, cam.fov_deg, cam.aspect);
+}
+
+double percentile(std::vector<double> values, double p)
+{
+        if (values.empty())
+                return 0.0;
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+double mean(const std::vector<double> &values)
+{
+        double sum = 0.0;
+        for (double v : values)
+                sum += v;
+        return values.empty() ? 0.0 : sum / values.size();
+}
+
+std::string json_string(const std::string &text)
+{
+        std::string out = "\"";
+        for (char ch : text)
+        {
+                if (ch == '"' || ch == '\\')
+                        out += '\\';
+                out += ch;
+        }
+        return out + "\"";
+}
+
+} // namespace
+
+bool run_benchmark(const BenchOptions &options)
+{
+        Scene scene;
+        Camera cam({0, 0, -10}, {0, 0, 0}, 60.0, 1.0);
+        float scale = 1.0f;
+        if (g_settings.quality == 'M' || g_settings.quality == 'm')
+                scale = 1.5f;
+        else if (g_settings.quality == 'L' || g_settings.quality == 'l')
+                scale = 2.5f;
+        int RW = options.width > 0 ? options.width
+                                   : std::max(1, static_cast<int>(g_settings.width / scale));
+        int RH = options.height > 0 ? options.height
+                                    : std::max(1, static_cast<int>(g_settings.height / scale));
+        if (!Parser::parse_rt_file(options.scene_path, scene, cam, RW, RH))
+        {
+                std::cerr << "Failed to parse scene: " << options.scene_path << "\n";
+                return false;
+        }
+        cam.aspect = static_cast<double>(RW) / RH;
+        std::vector<Material> mats = Parser::get_materials();
+        scene.update_beams(mats);
+        scene.build_bvh();
+
+        BenchPath path;
+        if (options.path_file.empty())
+                path = default_path(scene, cam, options.frames);
+        else if (!load_path(options.path_file, path))
+                return false;
+
+        int T = static_cast<int>(std::thread::hardware_concurrency());
+        if (T <= 0)
+                T = 8;
+        Renderer renderer(scene, cam);
+        std::vector<ColorF> framebuffer(static_cast<size_t>(RW) * RH);
+        std::vector<double> frame_ms, trace_ms, score_ms;
+        long long rays = 0;
+        RayCounters counters;
+        size_t next_edit = 0;
+        for (int frame = 0; frame < options.frames; ++frame)
+        {
+                auto start = std::chrono::steady_clock::now();
+                place_camera(path, frame, cam);
+                bool edited = false;
+                for (; next_edit < path.edits.size() && path.edits[next_edit].frame <= frame;
+                     ++next_edit)
+                {
+                        const ObjectEdit &e = path.edits[next_edit];
+                        if (e.index < 0 || e.index >= static_cast<int>(scene.objects.size()))
+                                continue;
+                        if (e.rotate)
+                                scene.rotate_object(e.index, e.vector.normalized(),
+                                                    e.degrees * M_PI / 180.0);
+                        else
+                                scene.move_with_collision(e.index, e.vector);
+                        edited = true;
+                }
+                if (edited)
+                {
+                        scene.update_beams(mats);
+                        scene.build_bvh();
+                }
+                FrameTiming timing = renderer.render_offscreen(framebuffer, RW, RH, T, mats);
+                frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                                           std::chrono::steady_clock::now() - start)
+                                           .count());
+                trace_ms.push_back(timing.trace_ms);
+                score_ms.push_back(timing.score_ms);
+                rays += timing.rays;
+                counters += timing.counters;
+        }
+
+        double trace_seconds = mean(trace_ms) * trace_ms.size() / 1000.0;
+        std::ostringstream json;
+        json << "{\n"
+             << "  \"scene\": " << json_string(options.scene_path) << ",\n"
+             << "  \"frames\": " << options.frames << ",\n"
+             << "  \"width\": " << RW << ",\n"
+             << "  \"height\": " << RH << ",\n"
+             << "  \"threads\": " << T << ",\n"
+             << "  \"quality\": " << json_string(std::string(1, g_settings.quality)) << ",\n"
+             << "  \"frame_ms\": {\"mean\": " << mean(frame_ms)
+             << ", \"p50\": " << percentile(frame_ms, 0.50)
+             << ", \"p95\": " << percentile(frame_ms, 0.95)
+             << ", \"p99\": " << percentile(frame_ms, 0.99) << "},\n"
+             << "  \"trace_ms\": {\"mean\": " << mean(trace_ms)
+             << ", \"p95\": " << percentile(trace_ms, 0.95) << "},\n"
+             << "  \"score_ms\": {\"mean\": " << mean(score_ms)
+             << ", \"p95\": " << percentile(score_ms, 0.95) << "},\n"
+             << "  \"rays\": " << rays << ",\n"
+             << "  \"rays_per_second\": " << (trace_seconds > 0.0 ? rays / trace_seconds : 0.0);
+        if (ray_stats::kEnabled)
+        {
+                json << ",\n  \"ray_stats\": ";
+                counters.write_json(json);
+        }
+        json << "\n}\n";
+
+        if (options.output_path.empty())
+        {
+                std::cout << json.str();
+                return true;
+        }
+        std::ofstream out(options.output_path);
+        out << json.str();
+        if (!out)
+        {
+                std::cerr << "Failed to write bench report: " << options.output_path << "\n";
+                return false;
+        }
+        return true;
+}
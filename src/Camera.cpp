@@ -46,3 +46,25 @@ Ray Camera::ray_through(double u, double v) const
 			.normalized();
 	return Ray(origin, dir);
 }
+
+PixelGrid Camera::pixel_grid(int width, int height) const
+{
+	double fov_rad = fov_deg * M_PI / 180.0;
+	double half_h = std::tan(fov_rad * 0.5);
+	double half_w = aspect * half_h;
+	PixelGrid grid;
+	grid.origin = origin;
+	grid.dx = right * (2.0 * half_w / width);
+	grid.dy = up * (-2.0 * half_h / height);
+	grid.corner = forward - right * half_w + up * half_h + grid.dx * 0.5 + grid.dy * 0.5;
+	return grid;
+}
+
+Frustum PixelGrid::tile_frustum(int x0, int y0, int x1, int y1) const
+{
+	const Vec3 corners[4] = {direction(x0, y0), direction(x1 - 1, y0),
+							 direction(x1 - 1, y1 - 1), direction(x0, y1 - 1)};
+	Frustum f;
+	f.set(origin, corners);
+	return f;
+}
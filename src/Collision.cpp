@@ -8,6 +8,10 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MINIRT_SSE_SUPPORT 1
+#endif
 
 namespace
 {
@@ -46,12 +50,13 @@ static Vec3 support(const Cone &co, const Vec3 &dir)
 	double axial = Vec3::dot(dir, co.axis);
 	Vec3 apex = co.center + co.axis * (co.height * 0.5);
 	Vec3 base = co.center - co.axis * (co.height * 0.5);
-	if (axial > 0)
-		return apex;
 	Vec3 radial = dir - co.axis * axial;
 	if (radial.length_squared() > 1e-9)
 		radial = radial.normalized() * co.radius;
-	return base + radial;
+	// The base rim can reach further than the apex even for directions
+	// that lean towards the apex.
+	Vec3 rim = base + radial;
+	return Vec3::dot(apex, dir) > Vec3::dot(rim, dir) ? apex : rim;
 }
 
 static Vec3 support_box(const AABB &b, const Vec3 &dir)
@@ -60,7 +65,8 @@ static Vec3 support_box(const AABB &b, const Vec3 &dir)
 				dir.z > 0 ? b.max.z : b.min.z);
 }
 
-static bool sat_cube_cube(const Cube &a, const Cube &b)
+// On separation `axis` receives the separating axis, pointing from a to b.
+static bool sat_cube_cube(const Cube &a, const Cube &b, Vec3 &axis)
 {
 	constexpr double EPS = 1e-6;
 
@@ -88,7 +94,10 @@ static bool sat_cube_cube(const Cube &a, const Cube &b)
 		rb = b_half[0] * absR[i][0] + b_half[1] * absR[i][1] +
 			 b_half[2] * absR[i][2];
 		if (std::fabs(t[i]) > ra + rb)
+		{
+			axis = a.axis[i] * (t[i] > 0 ? 1.0 : -1.0);
 			return false;
+		}
 	}
 
 	for (int i = 0; i < 3; ++i)
@@ -96,10 +105,12 @@ static bool sat_cube_cube(const Cube &a, const Cube &b)
 		ra = a_half[0] * absR[0][i] + a_half[1] * absR[1][i] +
 			 a_half[2] * absR[2][i];
 		rb = b_half[i];
-		double tval =
-			std::fabs(t[0] * R[0][i] + t[1] * R[1][i] + t[2] * R[2][i]);
-		if (tval > ra + rb)
+		double proj = t[0] * R[0][i] + t[1] * R[1][i] + t[2] * R[2][i];
+		if (std::fabs(proj) > ra + rb)
+		{
+			axis = b.axis[i] * (proj > 0 ? 1.0 : -1.0);
 			return false;
+		}
 	}
 
 	for (int i = 0; i < 3; ++i)
@@ -112,15 +123,41 @@ static bool sat_cube_cube(const Cube &a, const Cube &b)
 			int j2 = (j + 2) % 3;
 			ra = a_half[i1] * absR[i2][j] + a_half[i2] * absR[i1][j];
 			rb = b_half[j1] * absR[i][j2] + b_half[j2] * absR[i][j1];
-			double tval = std::fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]);
-			if (tval > ra + rb)
+			double proj = t[i2] * R[i1][j] - t[i1] * R[i2][j];
+			if (std::fabs(proj) > ra + rb)
+			{
+				axis = Vec3::cross(a.axis[i], b.axis[j]) * (proj > 0 ? 1.0 : -1.0);
 				return false;
+			}
 		}
 	}
 
 	return true;
 }
 
+// Closest point of the cube to p; p itself when it lies inside.
+static Vec3 closest_on_cube(const Cube &c, const Vec3 &p)
+{
+	Vec3 local = p - c.center;
+	double half[3] = {c.half.x, c.half.y, c.half.z};
+	Vec3 res = c.center;
+	for (int i = 0; i < 3; ++i)
+	{
+		double d = Vec3::dot(local, c.axis[i]);
+		res += c.axis[i] * std::max(-half[i], std::min(half[i], d));
+	}
+	return res;
+}
+
+// On separation `axis` receives the separating axis, pointing from a to b.
+static bool sphere_cube(const Sphere &s, const Cube &c, bool sphere_first, Vec3 &axis)
+{
+	Vec3 closest = closest_on_cube(c, s.center);
+	Vec3 gap = closest - s.center;
+	axis = sphere_first ? gap : (-1) * gap;
+	return gap.length_squared() <= s.radius * s.radius;
+}
+
 static Vec3 support(const Hittable &h, const Vec3 &dir)
 {
 	switch (h.shape_type())
@@ -242,16 +279,80 @@ static bool handle_simplex(std::array<Vec3, 4> &simplex, int &size, Vec3 &dir)
 	return false;
 }
 
-static bool gjk(const Hittable &a, const Hittable &b)
+// Support mapping fixed for the length of one GJK query. Cubes are packed
+// as float columns of their scaled axes, so picking a corner takes a few
+// SSE ops instead of three dot products and branches; other shapes and
+// builds without SSE use the scalar support above.
+class PackedSupport
 {
-	Vec3 dir(1, 0, 0);
+	public:
+	explicit PackedSupport(const Hittable &h) : shape(h)
+	{
+#ifdef MINIRT_SSE_SUPPORT
+		if (h.shape_type() != ShapeType::Cube)
+			return;
+		const Cube &c = static_cast<const Cube &>(h);
+		Vec3 e0 = c.axis[0] * c.half.x;
+		Vec3 e1 = c.axis[1] * c.half.y;
+		Vec3 e2 = c.axis[2] * c.half.z;
+		center = c.center;
+		col[0] = _mm_setr_ps(float(e0.x), float(e1.x), float(e2.x), 0.0f);
+		col[1] = _mm_setr_ps(float(e0.y), float(e1.y), float(e2.y), 0.0f);
+		col[2] = _mm_setr_ps(float(e0.z), float(e1.z), float(e2.z), 0.0f);
+		packed = true;
+#endif
+	}
+
+	Vec3 operator()(const Vec3 &dir) const
+	{
+#ifdef MINIRT_SSE_SUPPORT
+		if (packed)
+		{
+			// Lane i holds dot(dir, axis i) scaled by its half extent.
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(col[0], _mm_set1_ps(float(dir.x))),
+						   _mm_mul_ps(col[1], _mm_set1_ps(float(dir.y)))),
+				_mm_mul_ps(col[2], _mm_set1_ps(float(dir.z))));
+			__m128 positive = _mm_cmpgt_ps(d, _mm_setzero_ps());
+			__m128 sign = _mm_or_ps(_mm_and_ps(positive, _mm_set1_ps(1.0f)),
+									_mm_andnot_ps(positive, _mm_set1_ps(-1.0f)));
+			__m128 x = _mm_mul_ps(col[0], sign);
+			__m128 y = _mm_mul_ps(col[1], sign);
+			__m128 z = _mm_mul_ps(col[2], sign);
+			__m128 w = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			alignas(16) float out[4];
+			_mm_store_ps(out, _mm_add_ps(_mm_add_ps(x, y), z));
+			return center + Vec3(out[0], out[1], out[2]);
+		}
+#endif
+		return support(shape, dir);
+	}
+
+	private:
+	const Hittable &shape;
+#ifdef MINIRT_SSE_SUPPORT
+	bool packed = false;
+	Vec3 center;
+	__m128 col[3];
+#endif
+};
+
+// `dir` is the initial search direction; on separation it is left
+// holding a direction along which a lies entirely behind b.
+static bool gjk(const Hittable &a, const Hittable &b, Vec3 &dir)
+{
+	PackedSupport sa(a);
+	PackedSupport sb(b);
+	if (dir.length_squared() <= 1e-12)
+		dir = Vec3(1, 0, 0);
 	std::array<Vec3, 4> simplex;
 	int size = 0;
-	simplex[size++] = support(a, dir) - support(b, (-1) * dir);
+	simplex[size++] = sa(dir) - sb((-1) * dir);
 	dir = (-1) * simplex[0];
 	for (int iterations = 0; iterations < 64; ++iterations)
 	{
-		Vec3 p = support(a, dir) - support(b, (-1) * dir);
+		Vec3 p = sa(dir) - sb((-1) * dir);
 		if (Vec3::dot(p, dir) <= 0)
 			return false;
 		simplex[size++] = p;
@@ -261,9 +362,225 @@ static bool gjk(const Hittable &a, const Hittable &b)
 	return false;
 }
 
+// True when `axis` still separates the shapes, checked with one support
+// query on each. Strict, so touching pairs go on to the exact tests.
+static bool separated_along(const Hittable &a, const Hittable &b, const Vec3 &axis)
+{
+	if (axis.length_squared() <= 1e-12)
+		return false;
+	Vec3 p = support(a, axis) - support(b, (-1) * axis);
+	return Vec3::dot(p, axis) < 0;
+}
+
+// Support of the Minkowski difference (a + offset) - b.
+static Vec3 support_diff(const Hittable &a, const Vec3 &offset, const Hittable &b,
+						 const Vec3 &dir)
+{
+	return support(a, dir) + offset - support(b, (-1) * dir);
+}
+
+// Closest point to the origin on segment ab; reduces the simplex to the
+// feature that holds it.
+static Vec3 closest_on_segment(std::array<Vec3, 4> &pts, int &n)
+{
+	Vec3 a = pts[0];
+	Vec3 ab = pts[1] - a;
+	double len2 = ab.length_squared();
+	double t = len2 > 1e-18 ? -Vec3::dot(a, ab) / len2 : 0.0;
+	if (t <= 0.0)
+	{
+		n = 1;
+		return a;
+	}
+	if (t >= 1.0)
+	{
+		pts[0] = pts[1];
+		n = 1;
+		return pts[0];
+	}
+	return a + ab * t;
+}
+
+// Closest point to the origin on triangle abc (Ericson, Real-Time Collision
+// Detection 5.1.5), reducing the simplex to the vertex, edge or face used.
+static Vec3 closest_on_triangle(std::array<Vec3, 4> &pts, int &n)
+{
+	Vec3 a = pts[0], b = pts[1], c = pts[2];
+	Vec3 ab = b - a, ac = c - a;
+	Vec3 ap = (-1) * a;
+	double d1 = Vec3::dot(ab, ap), d2 = Vec3::dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0)
+	{
+		n = 1;
+		return a;
+	}
+	Vec3 bp = (-1) * b;
+	double d3 = Vec3::dot(ab, bp), d4 = Vec3::dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3)
+	{
+		pts[0] = b;
+		n = 1;
+		return b;
+	}
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+	{
+		n = 2;
+		return a + ab * (d1 / (d1 - d3));
+	}
+	Vec3 cp = (-1) * c;
+	double d5 = Vec3::dot(ab, cp), d6 = Vec3::dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6)
+	{
+		pts[0] = c;
+		n = 1;
+		return c;
+	}
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+	{
+		pts[1] = c;
+		n = 2;
+		return a + ac * (d2 / (d2 - d6));
+	}
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+	{
+		pts[0] = b;
+		pts[1] = c;
+		n = 2;
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	double sum = va + vb + vc;
+	if (std::fabs(sum) <= 1e-18)
+	{
+		n = 1;
+		return a;
+	}
+	return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+// Closest point to the origin on tetrahedron pts[0..3]. Returns false when
+// the origin lies inside it.
+static bool closest_on_tetrahedron(std::array<Vec3, 4> &pts, int &n, Vec3 &closest)
+{
+	// A flat tetrahedron encloses nothing, and its face tests cannot tell
+	// sides apart. Keep the closest point of the triangle it grew from;
+	// the new vertex then comes back as a duplicate and ends the search.
+	Vec3 ab = pts[1] - pts[0], ac = pts[2] - pts[0], ad = pts[3] - pts[0];
+	double volume = std::fabs(Vec3::dot(ad, Vec3::cross(ab, ac)));
+	if (volume <= 1e-9 * ab.length() * ac.length() * ad.length())
+	{
+		n = 3;
+		closest = closest_on_triangle(pts, n);
+		return true;
+	}
+	static const int kFaces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+	bool found = false;
+	double best = 0.0;
+	std::array<Vec3, 4> best_pts;
+	int best_n = 0;
+	for (const auto &f : kFaces)
+	{
+		Vec3 a = pts[f[0]], b = pts[f[1]], c = pts[f[2]], d = pts[f[3]];
+		Vec3 normal = Vec3::cross(b - a, c - a);
+		double side_origin = Vec3::dot((-1) * a, normal);
+		double side_other = Vec3::dot(d - a, normal);
+		if (side_origin * side_other >= 0)
+			continue;
+		std::array<Vec3, 4> face = {a, b, c, c};
+		int face_n = 3;
+		Vec3 p = closest_on_triangle(face, face_n);
+		double dist2 = p.length_squared();
+		if (!found || dist2 < best)
+		{
+			found = true;
+			best = dist2;
+			best_pts = face;
+			best_n = face_n;
+			closest = p;
+		}
+	}
+	if (!found)
+		return false;
+	pts = best_pts;
+	n = best_n;
+	return true;
+}
+
+// GJK distance query between a translated by `offset` and b. Returns false
+// when they overlap; otherwise `dist` is a lower bound on their distance,
+// proven by a separating plane with normal `normal` (from a towards b).
+static bool gjk_distance(const Hittable &a, const Vec3 &offset, const Hittable &b,
+						 double &dist, Vec3 &normal)
+{
+	std::array<Vec3, 4> simplex;
+	int n = 0;
+	Vec3 v = support_diff(a, offset, b, Vec3(1, 0, 0));
+	simplex[n++] = v;
+	for (int iterations = 0; iterations < 64; ++iterations)
+	{
+		double vv = v.length_squared();
+		if (vv <= 1e-18)
+			return false;
+		Vec3 w = support_diff(a, offset, b, (-1) * v);
+		if (vv - Vec3::dot(v, w) <= 1e-10 * vv)
+			break;
+		bool duplicate = false;
+		for (int i = 0; i < n; ++i)
+			duplicate = duplicate || (simplex[i] - w).length_squared() <= 1e-18;
+		if (duplicate)
+			break;
+		simplex[n++] = w;
+		if (n == 2)
+			v = closest_on_segment(simplex, n);
+		else if (n == 3)
+			v = closest_on_triangle(simplex, n);
+		else if (!closest_on_tetrahedron(simplex, n, v))
+			return false;
+	}
+	double len = v.length();
+	if (len <= 1e-9)
+		return false;
+	// |v| only bounds the distance from above. The support plane through
+	// w bounds it from below, which is what a conservative caller needs.
+	Vec3 w = support_diff(a, offset, b, (-1) * v);
+	dist = std::max(0.0, Vec3::dot(v, w) / len);
+	normal = v * (-1.0 / len);
+	return true;
+}
+
+// Swept test of any shape against a plane, using the shape's supports
+// along the plane normal.
+static bool sweep_against_plane(const Hittable &moving, const Vec3 &delta,
+								const Plane &pl, double &toi, Vec3 &normal)
+{
+	Vec3 N = pl.normal;
+	double high = Vec3::dot(support(moving, N) - pl.point, N);
+	double low = Vec3::dot(support(moving, (-1) * N) - pl.point, N);
+	if (low <= 0 && high >= 0)
+	{
+		toi = 0.0;
+		normal = Vec3(0, 0, 0);
+		return true;
+	}
+	double along = Vec3::dot(delta, N);
+	double gap = low > 0 ? low : -high;
+	double closing = low > 0 ? -along : along;
+	if (closing <= 1e-12)
+		return false;
+	double t = std::max(0.0, gap - 0.5 * kContactDistance) / closing;
+	if (t > 1.0)
+		return false;
+	toi = t;
+	normal = low > 0 ? (-1) * N : N;
+	return true;
+}
+
 } // namespace
 
-bool precise_collision(const HittablePtr &a, const HittablePtr &b)
+bool precise_collision(const HittablePtr &a, const HittablePtr &b,
+					   Vec3 *separating_axis)
 {
 	if (!a || !b)
 		return false;
@@ -311,14 +628,18 @@ bool precise_collision(const HittablePtr &a, const HittablePtr &b)
 		}
 		case ShapeType::Cone:
 		{
+			// Apex and base rim bound the cone along the normal; unlike
+			// a cylinder it is not symmetric about its center.
 			const Cone *co = static_cast<const Cone *>(other.get());
-			double axial = std::fabs(Vec3::dot(co->axis, pl->normal));
+			double axial = Vec3::dot(co->axis, pl->normal);
 			double radial =
 				std::sqrt(std::max(0.0, 1.0 - axial * axial)) * co->radius;
-			double extent = axial * (co->height * 0.5) + radial;
-			double dist =
-				std::fabs(Vec3::dot(co->center - pl->point, pl->normal));
-			return dist <= extent;
+			double dist = Vec3::dot(co->center - pl->point, pl->normal);
+			double apex = dist + axial * (co->height * 0.5);
+			double base = dist - axial * (co->height * 0.5);
+			double high = std::max(apex, base + radial);
+			double low = std::min(apex, base - radial);
+			return low <= 0 && high >= 0;
 		}
 		default:
 		{
@@ -330,11 +651,16 @@ bool precise_collision(const HittablePtr &a, const HittablePtr &b)
 		}
 	}
 
+	Vec3 local_axis(0, 0, 0);
+	Vec3 &axis = separating_axis ? *separating_axis : local_axis;
+	if (separated_along(*a, *b, axis))
+		return false;
+
 	if (ta == ShapeType::Cube && tb == ShapeType::Cube)
 	{
 		const Cube *ca = static_cast<const Cube *>(a.get());
 		const Cube *cb = static_cast<const Cube *>(b.get());
-		return sat_cube_cube(*ca, *cb);
+		return sat_cube_cube(*ca, *cb, axis);
 	}
 
 	if (ta == ShapeType::Sphere && tb == ShapeType::Sphere)
@@ -342,8 +668,89 @@ bool precise_collision(const HittablePtr &a, const HittablePtr &b)
 		const Sphere *sa = static_cast<const Sphere *>(a.get());
 		const Sphere *sb = static_cast<const Sphere *>(b.get());
 		double rad = sa->radius + sb->radius;
-		return (sa->center - sb->center).length_squared() <= rad * rad;
+		axis = sb->center - sa->center;
+		return axis.length_squared() <= rad * rad;
 	}
 
-	return gjk(*a, *b);
+	if (ta == ShapeType::Sphere && tb == ShapeType::Cube)
+		return sphere_cube(*static_cast<const Sphere *>(a.get()),
+						   *static_cast<const Cube *>(b.get()), true, axis);
+	if (ta == ShapeType::Cube && tb == ShapeType::Sphere)
+		return sphere_cube(*static_cast<const Sphere *>(b.get()),
+						   *static_cast<const Cube *>(a.get()), false, axis);
+
+	return gjk(*a, *b, axis);
+}
+
+bool sweep_collision(const Hittable &moving, const Vec3 &delta, const Hittable &other,
+					 double &toi, Vec3 &normal)
+{
+	if (moving.is_beam() || other.is_beam())
+		return false;
+	if (other.is_plane())
+		return sweep_against_plane(moving, delta, static_cast<const Plane &>(other), toi,
+								   normal);
+	if (moving.is_plane())
+	{
+		// Sweep the other shape the opposite way against the plane.
+		if (!sweep_against_plane(other, (-1) * delta,
+								 static_cast<const Plane &>(moving), toi, normal))
+			return false;
+		normal = (-1) * normal;
+		return true;
+	}
+	// Conservative advancement. For a pure translation the distance is
+	// convex in t, so stepping by distance over closing speed never
+	// passes the first contact.
+	double t = 0.0;
+	for (int iterations = 0; iterations < 32; ++iterations)
+	{
+		double dist;
+		Vec3 n;
+		if (!gjk_distance(moving, delta * t, other, dist, n))
+		{
+			// Past the start this is rounding inside the contact skin;
+			// the previous normal still applies.
+			toi = t;
+			if (t == 0.0)
+				normal = Vec3(0, 0, 0);
+			return true;
+		}
+		normal = n;
+		double closing = Vec3::dot(delta, n);
+		if (dist <= kContactDistance)
+		{
+			// Inside the skin only motion that closes on the other shape is
+			// blocked. GJK normals are good to about 1e-3 rad (worse along
+			// the sides of long cylinders), so a slide along the surface may
+			// close by that much, provided a quarter of the skin remains.
+			double remaining = closing * (1.0 - t);
+			if (remaining <= 1e-12 || (remaining <= 1e-3 * delta.length() &&
+									   remaining < dist - 0.25 * kContactDistance))
+				return false;
+			toi = t;
+			return true;
+		}
+		if (closing <= 1e-12)
+			return false;
+		t += (dist - 0.5 * kContactDistance) / closing;
+		if (t > 1.0)
+			return false;
+	}
+	// Out of iterations: everything up to t is proven free, so stop there.
+	toi = t;
+	return true;
+}
+
+bool CollisionCache::collide(const HittablePtr &a, const HittablePtr &b)
+{
+	if (axes.size() > kMaxEntries)
+		axes.clear();
+	Vec3 &axis = axes[Key{a.get(), b.get()}];
+	return precise_collision(a, b, &axis);
+}
+
+void CollisionCache::clear()
+{
+	axes.clear();
 }
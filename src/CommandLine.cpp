@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include <system_error>
@@ -24,6 +25,10 @@ namespace
 
 bool g_force_single_level_mode = false;
 std::filesystem::path g_forced_scene_path;
+BenchOptions g_bench_options;
+BatchOptions g_batch_options;
+std::string g_record_path;
+std::string g_replay_path;
 
 std::filesystem::path normalize_path(const std::filesystem::path &path)
 {
@@ -37,6 +42,167 @@ std::filesystem::path normalize_path(const std::filesystem::path &path)
     return absolute_path.lexically_normal();
 }
 
+bool check_scene_file(const std::string &provided_path)
+{
+    namespace fs = std::filesystem;
+
+    if (provided_path.empty())
+    {
+        std::cerr << "Error: Scene path cannot be empty.\n";
+        return false;
+    }
+
+    fs::path scene_file(provided_path);
+    std::string extension = to_lower(scene_file.extension().string());
+    if (extension != ".toml")
+    {
+        std::cerr << "Error: Scene file must have a .toml extension.\n";
+        return false;
+    }
+
+    std::error_code ec;
+    if (!fs::exists(scene_file, ec) || !fs::is_regular_file(scene_file, ec))
+    {
+        std::cerr << "Error: Scene file '" << provided_path << "' was not found.\n";
+        return false;
+    }
+    return true;
+}
+
+bool parse_positive(const char *text, int &value)
+{
+    char *end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || parsed <= 0 || parsed > 1000000)
+    {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// --bench scene.toml [--frames N] [--path file] [--width W] [--height H] [--out file]
+bool parse_bench_arguments(int argc, char **argv)
+{
+    BenchOptions options;
+    options.enabled = true;
+    if (argc < 3 || !check_scene_file(argv[2]))
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " --bench scene.toml [--frames N] [--path file] [--width W]"
+                     " [--height H] [--out report.json]\n";
+        return false;
+    }
+    options.scene_path = normalize_path(argv[2]).string();
+    for (int i = 3; i < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Error: " << flag << " needs a value.\n";
+            return false;
+        }
+        const char *value = argv[i + 1];
+        bool ok = true;
+        if (flag == "--frames")
+        {
+            ok = parse_positive(value, options.frames);
+        }
+        else if (flag == "--width")
+        {
+            ok = parse_positive(value, options.width);
+        }
+        else if (flag == "--height")
+        {
+            ok = parse_positive(value, options.height);
+        }
+        else if (flag == "--path")
+        {
+            options.path_file = value;
+        }
+        else if (flag == "--out")
+        {
+            options.output_path = value;
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option '" << flag << "'.\n";
+            return false;
+        }
+        if (!ok)
+        {
+            std::cerr << "Error: " << flag << " needs a positive number.\n";
+            return false;
+        }
+    }
+    g_bench_options = options;
+    return true;
+}
+
+// --render-all [--scenes dir] [--out dir] [--width W] [--height H] [--threads N]
+//              [--format ppm|png|pfm]
+bool parse_batch_arguments(int argc, char **argv)
+{
+    BatchOptions options;
+    options.enabled = true;
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Error: " << flag << " needs a value.\n";
+            return false;
+        }
+        const char *value = argv[i + 1];
+        bool ok = true;
+        if (flag == "--scenes")
+        {
+            options.scenes_dir = value;
+        }
+        else if (flag == "--out")
+        {
+            options.output_dir = value;
+        }
+        else if (flag == "--width")
+        {
+            ok = parse_positive(value, options.width);
+        }
+        else if (flag == "--height")
+        {
+            ok = parse_positive(value, options.height);
+        }
+        else if (flag == "--threads")
+        {
+            ok = parse_positive(value, options.threads);
+        }
+        else if (flag == "--format")
+        {
+            std::string format = to_lower(value);
+            if (format != "ppm" && format != "png" && format != "pfm")
+            {
+                std::cerr << "Error: --format must be ppm, png or pfm.\n";
+                return false;
+            }
+            options.format = image_format_for("." + format);
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option '" << flag << "'.\n"
+                      << "Usage: " << argv[0]
+                      << " --render-all [--scenes dir] [--out dir] [--width W] [--height H]"
+                         " [--threads N] [--format ppm|png|pfm]\n";
+            return false;
+        }
+        if (!ok)
+        {
+            std::cerr << "Error: " << flag << " needs a positive number.\n";
+            return false;
+        }
+    }
+    g_batch_options = options;
+    return true;
+}
+
 } // namespace
 
 bool parse_arguments(int argc, char **argv, std::string &scene_path, bool &skip_main_menu)
@@ -47,40 +213,60 @@ bool parse_arguments(int argc, char **argv, std::string &scene_path, bool &skip_
     skip_main_menu = false;
     g_force_single_level_mode = false;
     g_forced_scene_path.clear();
+    g_bench_options = BenchOptions();
+    g_batch_options = BatchOptions();
+    g_record_path.clear();
+    g_replay_path.clear();
 
     if (argc <= 1)
     {
         return true;
     }
 
-    if (argc > 2)
+    if (std::string(argv[1]) == "--bench")
     {
-        std::cerr << "Usage: " << argv[0] << " [path/to/scene.toml]\n";
-        return false;
+        return parse_bench_arguments(argc, argv);
     }
-
-    std::string provided_path = argv[1];
-    if (provided_path.empty())
+    if (std::string(argv[1]) == "--render-all")
     {
-        std::cerr << "Error: Scene path cannot be empty.\n";
-        return false;
+        return parse_batch_arguments(argc, argv);
     }
 
-    fs::path scene_file(provided_path);
-    std::string extension = to_lower(scene_file.extension().string());
-    if (extension != ".toml")
+    // scene.toml [--record file | --replay file]
+    bool usage_error = argc != 2 && argc != 4;
+    if (argc == 4)
     {
-        std::cerr << "Error: Scene file must have a .toml extension.\n";
+        std::string flag = argv[2];
+        if (flag == "--record")
+        {
+            g_record_path = argv[3];
+        }
+        else if (flag == "--replay")
+        {
+            g_replay_path = argv[3];
+        }
+        else
+        {
+            usage_error = true;
+        }
+    }
+    if (usage_error)
+    {
+        std::cerr << "Usage: " << argv[0] << " [path/to/scene.toml]\n"
+                  << "       " << argv[0]
+                  << " path/to/scene.toml --record input.bin | --replay input.bin\n"
+                  << "       " << argv[0] << " --bench path/to/scene.toml [options]\n"
+                  << "       " << argv[0] << " --render-all [options]\n";
         return false;
     }
 
-    std::error_code ec;
-    if (!fs::exists(scene_file, ec) || !fs::is_regular_file(scene_file, ec))
+    std::string provided_path = argv[1];
+    if (!check_scene_file(provided_path))
     {
-        std::cerr << "Error: Scene file '" << provided_path << "' was not found.\n";
         return false;
     }
 
+    fs::path scene_file(provided_path);
     g_forced_scene_path = normalize_path(scene_file);
     g_force_single_level_mode = true;
     scene_path = g_forced_scene_path.string();
@@ -97,3 +283,23 @@ const std::filesystem::path &forced_scene_path()
 {
     return g_forced_scene_path;
 }
+
+const BenchOptions &bench_options()
+{
+    return g_bench_options;
+}
+
+const BatchOptions &batch_options()
+{
+    return g_batch_options;
+}
+
+const std::string &record_path()
+{
+    return g_record_path;
+}
+
+const std::string &replay_path()
+{
+    return g_replay_path;
+}
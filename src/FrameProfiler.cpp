@@ -0,0 +1,123 @@
+#include "FrameProfiler.hpp"
+#include <fstream>
+#include <iomanip>
+
+FrameProfiler g_frame_profiler;
+
+const char *profile_stage_name(ProfileStage stage)
+{
+        switch (stage)
+        {
+        case ProfileStage::Events:
+                return "process_events";
+        case ProfileStage::Keyboard:
+                return "handle_keyboard";
+        case ProfileStage::Goals:
+                return "update_goal_targets";
+        case ProfileStage::Selection:
+                return "update_selection";
+        case ProfileStage::Beams:
+                return "update_beams";
+        case ProfileStage::Bvh:
+                return "build_bvh";
+        case ProfileStage::Save:
+                return "MapSaver::serialize";
+        case ProfileStage::Trace:
+                return "trace_frame";
+        case ProfileStage::Score:
+                return "compute_beam_score";
+        case ProfileStage::Convert:
+                return "pack_rgba8";
+        case ProfileStage::Hud:
+                return "render_hud";
+        default:
+                return "unknown";
+        }
+}
+
+FrameProfiler::FrameProfiler() : epoch(Clock::now()), ring(kHistory + 1) {}
+
+void FrameProfiler::begin_frame()
+{
+        Clock::time_point now = Clock::now();
+        if (current >= 0)
+        {
+                ring[current].frame_ms =
+                        std::chrono::duration<double, std::milli>(now - frame_start).count();
+                if (finished < kHistory)
+                        ++finished;
+        }
+        current = (current + 1) % static_cast<int>(ring.size());
+        Frame &f = ring[current];
+        for (double &ms : f.stage_ms)
+                ms = 0.0;
+        f.frame_ms = 0.0;
+        f.events.clear();
+        f.start_us = std::chrono::duration<double, std::micro>(now - epoch).count();
+        frame_start = now;
+        child_ms = 0.0;
+}
+
+const FrameProfiler::Frame &FrameProfiler::frame(int age) const
+{
+        // One slot more than kHistory holds the frame being recorded.
+        int size = static_cast<int>(ring.size());
+        return ring[((current - 1 - age) % size + size) % size];
+}
+
+void FrameProfiler::record(ProfileStage stage, Clock::time_point start, double ms,
+                           double self_ms)
+{
+        if (current < 0)
+                return;
+        Frame &f = ring[current];
+        f.stage_ms[static_cast<int>(stage)] += self_ms;
+        Event e;
+        e.stage = stage;
+        e.start_us = std::chrono::duration<double, std::micro>(start - epoch).count();
+        e.duration_us = ms * 1000.0;
+        f.events.push_back(e);
+}
+
+bool FrameProfiler::write_chrome_trace(const std::string &path) const
+{
+        std::ofstream out(path);
+        if (!out)
+                return false;
+        out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (int age = finished - 1; age >= 0; --age)
+        {
+                const Frame &f = frame(age);
+                out << (first ? "" : ",\n")
+                    << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                    << f.start_us << ",\"dur\":" << f.frame_ms * 1000.0 << "}";
+                first = false;
+                for (const Event &e : f.events)
+                {
+                        out << (first ? "" : ",\n") << "{\"name\":\""
+                            << profile_stage_name(e.stage)
+                            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << e.start_us
+                            << ",\"dur\":" << e.duration_us << "}";
+                        first = false;
+                }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return static_cast<bool>(out);
+}
+
+ProfileScope::ProfileScope(ProfileStage stage_, FrameProfiler &profiler_)
+        : profiler(profiler_), stage(stage_), start(FrameProfiler::Clock::now()),
+          outer_child_ms(profiler_.child_ms)
+{
+        profiler.child_ms = 0.0;
+}
+
+ProfileScope::~ProfileScope()
+{
+        double ms = std::chrono::duration<double, std::milli>(FrameProfiler::Clock::now() -
+                                                              start)
+                            .count();
+        profiler.record(stage, start, ms, ms - profiler.child_ms);
+        profiler.child_ms = outer_child_ms + ms;
+}
@@ -0,0 +1,21 @@
+#include "Framebuffer.hpp"
+#include <algorithm>
+
+static inline unsigned char to_byte(float c)
+{
+	return static_cast<unsigned char>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f +
+									  0.5f);
+}
+
+void pack_rgba8(const ColorF *src, size_t count, unsigned char *dst)
+{
+	// Four bytes per pixel keep every store aligned, which the compiler
+	// turns into one 32-bit write; RGB24 needed three byte stores.
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i * 4 + 0] = to_byte(src[i].r);
+		dst[i * 4 + 1] = to_byte(src[i].g);
+		dst[i * 4 + 2] = to_byte(src[i].b);
+		dst[i * 4 + 3] = 255;
+	}
+}
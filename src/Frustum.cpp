@@ -0,0 +1,38 @@
+#include "Frustum.hpp"
+
+void Frustum::set(const Vec3 &apex_, const Vec3 corners[4])
+{
+	apex = apex_;
+	plane_count = 0;
+	Vec3 centre = corners[0] + corners[1] + corners[2] + corners[3];
+	for (int i = 0; i < 4; ++i)
+	{
+		Vec3 n = Vec3::cross(corners[i], corners[(i + 1) % 4]);
+		double len = n.length();
+		if (len <= 1e-12)
+			continue;
+		n = n / len;
+		double side = Vec3::dot(n, centre);
+		// A plane that does not clearly have the centre ray on one side
+		// cannot tell inside from outside; leave it out.
+		if (std::fabs(side) <= 1e-9 * centre.length())
+			continue;
+		normals[plane_count++] = side > 0 ? n : n * -1.0;
+	}
+}
+
+bool Frustum::may_overlap(const AABB &box) const
+{
+	// Slack for rays running exactly along a side plane.
+	constexpr double kSlack = 1e-6;
+	for (int i = 0; i < plane_count; ++i)
+	{
+		const Vec3 &n = normals[i];
+		// Box corner furthest along the inward normal.
+		Vec3 p(n.x > 0 ? box.max.x : box.min.x, n.y > 0 ? box.max.y : box.min.y,
+			   n.z > 0 ? box.max.z : box.min.z);
+		if (Vec3::dot(n, p - apex) < -kSlack)
+			return false;
+	}
+	return true;
+}
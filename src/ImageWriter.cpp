@@ -0,0 +1,649 @@
+#include "ImageWriter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+unsigned char to_byte(double v)
+{
+        return static_cast<unsigned char>(std::lround(std::clamp(v, 0.0, 1.0) * 255.0));
+}
+
+void to_bytes(const Vec3 *row, int width, unsigned char *out)
+{
+        for (int x = 0; x < width; ++x)
+        {
+                *out++ = to_byte(row[x].x);
+                *out++ = to_byte(row[x].y);
+                *out++ = to_byte(row[x].z);
+        }
+}
+
+void to_floats(const Vec3 *row, int width, unsigned char *out)
+{
+        for (int x = 0; x < width; ++x)
+        {
+                float rgb[3] = {static_cast<float>(row[x].x), static_cast<float>(row[x].y),
+                                static_cast<float>(row[x].z)};
+                std::memcpy(out, rgb, sizeof(rgb));
+                out += sizeof(rgb);
+        }
+}
+
+bool little_endian()
+{
+        const uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+}
+
+uint32_t crc32(uint32_t crc, const unsigned char *data, size_t n)
+{
+        static const std::vector<uint32_t> table = []
+        {
+                std::vector<uint32_t> t(256);
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                        uint32_t c = i;
+                        for (int k = 0; k < 8; ++k)
+                                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                        t[i] = c;
+                }
+                return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < n; ++i)
+                crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+}
+
+void put_u32(std::vector<unsigned char> &out, uint32_t v)
+{
+        out.push_back(static_cast<unsigned char>(v >> 24));
+        out.push_back(static_cast<unsigned char>(v >> 16));
+        out.push_back(static_cast<unsigned char>(v >> 8));
+        out.push_back(static_cast<unsigned char>(v));
+}
+
+// zlib stream of fixed-Huffman deflate blocks. Input is matched against
+// the last 32 KiB with a hash chain; output accumulates in `out` for the
+// caller to drain. A run stays one open block until finish(), so the
+// encoder never needs to know the total size in advance.
+class Deflater
+{
+        public:
+        std::vector<unsigned char> out;
+
+        Deflater() : head(kHashSize, -1), prev(kWindow, -1)
+        {
+                out.push_back(0x78); // deflate, 32 KiB window
+                out.push_back(0x01);
+                put_bits(0, 1);      // not the final block
+                put_bits(1, 2);      // fixed Huffman codes
+        }
+
+        void write(const unsigned char *data, size_t n)
+        {
+                for (size_t i = 0; i < n; ++i)
+                {
+                        adler_a = (adler_a + data[i]) % 65521;
+                        adler_b = (adler_b + adler_a) % 65521;
+                }
+                buf.insert(buf.end(), data, data + n);
+                compress(false);
+        }
+
+        void finish()
+        {
+                compress(true);
+                put_symbol(256);
+                put_bits(1, 1); // empty final block
+                put_bits(1, 2);
+                put_symbol(256);
+                if (bit_count)
+                        out.push_back(static_cast<unsigned char>(bit_buf));
+                bit_buf = 0;
+                bit_count = 0;
+                put_u32(out, (adler_b << 16) | adler_a);
+        }
+
+        private:
+        static constexpr long kWindow = 32768;
+        static constexpr int kHashSize = 1 << 15;
+        static constexpr int kMinMatch = 3;
+        static constexpr int kMaxMatch = 258;
+        static constexpr int kMaxChain = 16;
+
+        std::vector<unsigned char> buf; // input from absolute offset `base`
+        long base = 0;
+        long pos = 0; // next input byte to encode
+        std::vector<long> head;
+        std::vector<long> prev;
+        uint32_t bit_buf = 0;
+        int bit_count = 0;
+        uint32_t adler_a = 1;
+        uint32_t adler_b = 0;
+
+        unsigned char at(long p) const { return buf[p - base]; }
+        long end() const { return base + static_cast<long>(buf.size()); }
+
+        void put_bits(uint32_t value, int n)
+        {
+                bit_buf |= value << bit_count;
+                bit_count += n;
+                while (bit_count >= 8)
+                {
+                        out.push_back(static_cast<unsigned char>(bit_buf));
+                        bit_buf >>= 8;
+                        bit_count -= 8;
+                }
+        }
+
+        // Huffman codes are stored most significant bit first.
+        void put_code(uint32_t code, int n)
+        {
+                uint32_t reversed = 0;
+                for (int i = 0; i < n; ++i)
+                        reversed |= ((code >> i) & 1) << (n - 1 - i);
+                put_bits(reversed, n);
+        }
+
+        void put_symbol(int sym)
+        {
+                if (sym <= 143)
+                        put_code(0x30 + sym, 8);
+                else if (sym <= 255)
+                        put_code(0x190 + sym - 144, 9);
+                else if (sym <= 279)
+                        put_code(sym - 256, 7);
+                else
+                        put_code(0xC0 + sym - 280, 8);
+        }
+
+        void put_match(int length, int distance)
+        {
+                static const int kLengthBase[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,
+                                                  15, 17, 19, 23, 27, 31, 35, 43, 51,  59,
+                                                  67, 83, 99, 115, 131, 163, 195, 227, 258};
+                static const int kLengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                   2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+                static const int kDistBase[] = {1,    2,    3,    4,     5,     7,    9,
+                                                13,   17,   25,   33,    49,    65,   97,
+                                                129,  193,  257,  385,   513,   769,  1025,
+                                                1537, 2049, 3073, 4097,  6145,  8193, 12289,
+                                                16385, 24577};
+                static const int kDistExtra[] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,  4,  4,  5,  5,  6,
+                                                 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+                int li = static_cast<int>(std::upper_bound(std::begin(kLengthBase),
+                                                           std::end(kLengthBase), length) -
+                                          std::begin(kLengthBase)) - 1;
+                put_symbol(257 + li);
+                put_bits(length - kLengthBase[li], kLengthExtra[li]);
+                int di = static_cast<int>(std::upper_bound(std::begin(kDistBase),
+                                                           std::end(kDistBase), distance) -
+                                          std::begin(kDistBase)) - 1;
+                put_code(di, 5);
+                put_bits(distance - kDistBase[di], kDistExtra[di]);
+        }
+
+        int hash(long p) const
+        {
+                return ((at(p) << 10) ^ (at(p + 1) << 5) ^ at(p + 2)) & (kHashSize - 1);
+        }
+
+        void insert(long p)
+        {
+                int h = hash(p);
+                prev[p & (kWindow - 1)] = head[h];
+                head[h] = p;
+        }
+
+        // Encode up to the end of the input, or up to kMaxMatch short of
+        // it while more input may follow, so matches are never cut short.
+        void compress(bool final)
+        {
+                long limit = final ? end() : end() - kMaxMatch;
+                while (pos < limit)
+                {
+                        int best = 0;
+                        long best_dist = 0;
+                        long avail = std::min<long>(kMaxMatch, end() - pos);
+                        if (avail >= kMinMatch)
+                        {
+                                long cand = head[hash(pos)];
+                                for (int chain = 0;
+                                     chain < kMaxChain && cand >= 0 && pos - cand <= kWindow;
+                                     ++chain)
+                                {
+                                        int len = 0;
+                                        while (len < avail && at(cand + len) == at(pos + len))
+                                                ++len;
+                                        if (len > best)
+                                        {
+                                                best = len;
+                                                best_dist = pos - cand;
+                                                if (len == avail)
+                                                        break;
+                                        }
+                                        long next = prev[cand & (kWindow - 1)];
+                                        if (next >= cand)
+                                                break;
+                                        cand = next;
+                                }
+                                insert(pos);
+                        }
+                        if (best >= kMinMatch)
+                        {
+                                put_match(best, static_cast<int>(best_dist));
+                                for (long p = pos + 1; p < pos + best && p + 2 < end(); ++p)
+                                        insert(p);
+                                pos += best;
+                        }
+                        else
+                        {
+                                put_symbol(at(pos));
+                                ++pos;
+                        }
+                }
+                // Keep only the window the next matches can reach.
+                if (pos - base > 8 * kWindow)
+                {
+                        long drop = pos - kWindow - base;
+                        buf.erase(buf.begin(), buf.begin() + drop);
+                        base += drop;
+                }
+        }
+};
+
+int paeth(int a, int b, int c)
+{
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+                return a;
+        return pb <= pc ? b : c;
+}
+
+} // namespace
+
+ImageFormat image_format_for(const std::string &path)
+{
+        auto ends_with = [&](const char *ext)
+        {
+                size_t n = std::strlen(ext);
+                if (path.size() < n)
+                        return false;
+                for (size_t i = 0; i < n; ++i)
+                        if (std::tolower(static_cast<unsigned char>(path[path.size() - n + i])) !=
+                            ext[i])
+                                return false;
+                return true;
+        };
+        if (ends_with(".png"))
+                return ImageFormat::Png;
+        if (ends_with(".pfm"))
+                return ImageFormat::Pfm;
+        return ImageFormat::Ppm;
+}
+
+const char *image_extension(ImageFormat format)
+{
+        switch (format)
+        {
+        case ImageFormat::Png:
+                return ".png";
+        case ImageFormat::Pfm:
+                return ".pfm";
+        default:
+                return ".ppm";
+        }
+}
+
+struct ImageWriter::Impl
+{
+        ImageFormat format = ImageFormat::Ppm;
+        std::string path;
+        int width = 0;
+        int height = 0;
+        std::atomic<int> rows_done{0};
+
+        // PPM and PFM: the whole file, mapped or buffered.
+        size_t header_bytes = 0;
+        size_t row_bytes = 0;
+        size_t file_bytes = 0;
+        unsigned char *data = nullptr;
+        std::vector<unsigned char> buffer;
+        int fd = -1;
+
+        // PNG: rows waiting for the ones above them, and the encoder.
+        std::mutex pending_mutex;
+        std::map<int, std::vector<Vec3>> pending;
+        std::mutex encode_mutex;
+        int next_row = 0;
+        std::ofstream out;
+        Deflater deflater;
+        std::vector<unsigned char> raw;
+        std::vector<unsigned char> above;
+        std::vector<unsigned char> filtered[5];
+
+        bool open_fixed(const std::string &header);
+        bool close_fixed();
+        bool open_png();
+        void write_chunk(const char *type, const unsigned char *bytes, size_t n);
+        void drain_deflater(bool all);
+        void encode_png_row(const Vec3 *row);
+        void drain_pending();
+        bool close_png();
+};
+
+bool ImageWriter::Impl::open_fixed(const std::string &header)
+{
+        header_bytes = header.size();
+        file_bytes = header_bytes + row_bytes * static_cast<size_t>(height);
+#ifndef _WIN32
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+                return false;
+        if (::ftruncate(fd, static_cast<off_t>(file_bytes)) == 0)
+        {
+                void *map = ::mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (map != MAP_FAILED)
+                        data = static_cast<unsigned char *>(map);
+        }
+#endif
+        if (!data)
+        {
+                buffer.resize(file_bytes);
+                data = buffer.data();
+        }
+        std::memcpy(data, header.data(), header_bytes);
+        return true;
+}
+
+bool ImageWriter::Impl::close_fixed()
+{
+        bool ok = true;
+#ifndef _WIN32
+        if (buffer.empty())
+                ok = ::munmap(data, file_bytes) == 0;
+        if (fd >= 0)
+                ok = ::close(fd) == 0 && ok;
+        fd = -1;
+#endif
+        data = nullptr;
+        if (buffer.empty())
+                return ok;
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(buffer.data()),
+                   static_cast<std::streamsize>(buffer.size()));
+        std::vector<unsigned char>().swap(buffer);
+        return ok && static_cast<bool>(file);
+}
+
+void ImageWriter::Impl::write_chunk(const char *type, const unsigned char *bytes, size_t n)
+{
+        std::vector<unsigned char> head;
+        put_u32(head, static_cast<uint32_t>(n));
+        head.insert(head.end(), type, type + 4);
+        uint32_t crc = crc32(crc32(0, head.data() + 4, 4), bytes, n);
+        std::vector<unsigned char> tail;
+        put_u32(tail, crc);
+        out.write(reinterpret_cast<const char *>(head.data()), 8);
+        out.write(reinterpret_cast<const char *>(bytes), static_cast<std::streamsize>(n));
+        out.write(reinterpret_cast<const char *>(tail.data()), 4);
+}
+
+bool ImageWriter::Impl::open_png()
+{
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+                return false;
+        static const unsigned char kSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        out.write(reinterpret_cast<const char *>(kSignature), sizeof(kSignature));
+        std::vector<unsigned char> ihdr;
+        put_u32(ihdr, static_cast<uint32_t>(width));
+        put_u32(ihdr, static_cast<uint32_t>(height));
+        ihdr.push_back(8); // bits per channel
+        ihdr.push_back(2); // RGB
+        ihdr.push_back(0); // deflate
+        ihdr.push_back(0); // adaptive filtering
+        ihdr.push_back(0); // not interlaced
+        write_chunk("IHDR", ihdr.data(), ihdr.size());
+        raw.resize(row_bytes);
+        above.assign(row_bytes, 0);
+        for (auto &f : filtered)
+                f.resize(row_bytes + 1);
+        return static_cast<bool>(out);
+}
+
+// IDAT chunks of 64 KiB, or whatever is left when `all` is set.
+void ImageWriter::Impl::drain_deflater(bool all)
+{
+        const size_t kChunk = 1 << 16;
+        std::vector<unsigned char> &bytes = deflater.out;
+        size_t done = 0;
+        while (bytes.size() - done >= kChunk || (all && done < bytes.size()))
+        {
+                size_t n = std::min(kChunk, bytes.size() - done);
+                write_chunk("IDAT", bytes.data() + done, n);
+                done += n;
+        }
+        bytes.erase(bytes.begin(), bytes.begin() + done);
+}
+
+// Filters the row with each PNG filter and keeps the one with the smallest
+// sum of absolute differences, the usual heuristic for photographic rows.
+void ImageWriter::Impl::encode_png_row(const Vec3 *row)
+{
+        to_bytes(row, width, raw.data());
+        const int bpp = 3;
+        long best_cost = -1;
+        int best = 0;
+        for (int type = 0; type < 5; ++type)
+        {
+                unsigned char *f = filtered[type].data();
+                f[0] = static_cast<unsigned char>(type);
+                long cost = 0;
+                for (size_t i = 0; i < row_bytes; ++i)
+                {
+                        int a = i >= bpp ? raw[i - bpp] : 0;
+                        int b = above[i];
+                        int c = i >= bpp ? above[i - bpp] : 0;
+                        int predicted = 0;
+                        switch (type)
+                        {
+                        case 1:
+                                predicted = a;
+                                break;
+                        case 2:
+                                predicted = b;
+                                break;
+                        case 3:
+                                predicted = (a + b) / 2;
+                                break;
+                        case 4:
+                                predicted = paeth(a, b, c);
+                                break;
+                        default:
+                                break;
+                        }
+                        unsigned char v = static_cast<unsigned char>(raw[i] - predicted);
+                        f[i + 1] = v;
+                        cost += v < 128 ? v : 256 - v;
+                }
+                if (best_cost < 0 || cost < best_cost)
+                {
+                        best_cost = cost;
+                        best = type;
+                }
+        }
+        deflater.write(filtered[best].data(), row_bytes + 1);
+        above.swap(raw);
+        drain_deflater(false);
+}
+
+// Encode every pending row that continues the image. Only one thread
+// encodes at a time; the others leave their rows for it.
+void ImageWriter::Impl::drain_pending()
+{
+        for (;;)
+        {
+                std::unique_lock<std::mutex> encoding(encode_mutex, std::try_to_lock);
+                if (!encoding.owns_lock())
+                        return;
+                for (;;)
+                {
+                        std::vector<Vec3> rows;
+                        {
+                                std::lock_guard<std::mutex> lock(pending_mutex);
+                                auto it = pending.find(next_row);
+                                if (it == pending.end())
+                                        break;
+                                rows.swap(it->second);
+                                pending.erase(it);
+                        }
+                        int count = static_cast<int>(rows.size()) / width;
+                        for (int r = 0; r < count; ++r)
+                                encode_png_row(&rows[static_cast<size_t>(r) * width]);
+                        next_row += count;
+                        rows_done += count;
+                }
+                int expected = next_row;
+                encoding.unlock();
+                // A row may have arrived after the last check but before
+                // the unlock; its writer then found the encoder busy.
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                if (pending.find(expected) == pending.end())
+                        return;
+        }
+}
+
+bool ImageWriter::Impl::close_png()
+{
+        drain_pending();
+        if (next_row == height)
+        {
+                deflater.finish();
+                drain_deflater(true);
+                write_chunk("IEND", nullptr, 0);
+        }
+        out.close();
+        return !out.fail();
+}
+
+ImageWriter::ImageWriter() = default;
+
+ImageWriter::~ImageWriter()
+{
+        if (impl)
+                close();
+}
+
+bool ImageWriter::open(const std::string &path, int width, int height)
+{
+        return open(path, width, height, image_format_for(path));
+}
+
+bool ImageWriter::open(const std::string &path, int width, int height, ImageFormat format)
+{
+        if (impl)
+                close();
+        if (width <= 0 || height <= 0)
+                return false;
+        impl = std::make_unique<Impl>();
+        impl->format = format;
+        impl->path = path;
+        impl->width = width;
+        impl->height = height;
+        std::string size = std::to_string(width) + " " + std::to_string(height) + "\n";
+        bool ok = false;
+        switch (format)
+        {
+        case ImageFormat::Ppm:
+                impl->row_bytes = static_cast<size_t>(width) * 3;
+                ok = impl->open_fixed("P6\n" + size + "255\n");
+                break;
+        case ImageFormat::Pfm:
+                // Negative scale marks little-endian floats.
+                impl->row_bytes = static_cast<size_t>(width) * 3 * sizeof(float);
+                ok = impl->open_fixed("PF\n" + size + (little_endian() ? "-1.0\n" : "1.0\n"));
+                break;
+        case ImageFormat::Png:
+                impl->row_bytes = static_cast<size_t>(width) * 3;
+                ok = impl->open_png();
+                break;
+        }
+        if (!ok)
+                impl.reset();
+        return ok;
+}
+
+void ImageWriter::write_rows(int y, const Vec3 *pixels, int rows)
+{
+        if (!impl || y < 0 || rows <= 0 || y + rows > impl->height)
+                return;
+        Impl &im = *impl;
+        if (im.format == ImageFormat::Png)
+        {
+                {
+                        std::lock_guard<std::mutex> lock(im.pending_mutex);
+                        im.pending[y].assign(pixels, pixels + static_cast<size_t>(rows) * im.width);
+                }
+                im.drain_pending();
+                return;
+        }
+        for (int r = 0; r < rows; ++r)
+        {
+                const Vec3 *row = pixels + static_cast<size_t>(r) * im.width;
+                if (im.format == ImageFormat::Pfm)
+                {
+                        // PFM stores the bottom row first.
+                        size_t offset = im.header_bytes + (im.height - 1 - (y + r)) * im.row_bytes;
+                        to_floats(row, im.width, im.data + offset);
+                }
+                else
+                {
+                        to_bytes(row, im.width, im.data + im.header_bytes + (y + r) * im.row_bytes);
+                }
+        }
+        im.rows_done += rows;
+}
+
+bool ImageWriter::close()
+{
+        if (!impl)
+                return false;
+        bool ok = impl->format == ImageFormat::Png ? impl->close_png() : impl->close_fixed();
+        ok = ok && impl->rows_done == impl->height;
+        impl.reset();
+        return ok;
+}
+
+bool write_image(const std::string &path, const std::vector<Vec3> &pixels, int width,
+                 int height)
+{
+        if (pixels.size() < static_cast<size_t>(width) * height)
+                return false;
+        ImageWriter writer;
+        if (!writer.open(path, width, height))
+                return false;
+        writer.write_rows(0, pixels.data(), height);
+        return writer.close();
+}
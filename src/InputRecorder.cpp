@@ -0,0 +1,303 @@
+#include "InputRecorder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+InputRecorder g_input_recorder;
+
+// File layout, host byte order:
+//   "MRTI" u32 version  i32 width  i32 height  u8 quality
+//   per frame: f64 dt  u16 n  u16 scancode[n]  u16 m  event[m]
+//   event: u32 type  u32 timestamp  fields of that type (see write_frame)
+static const char kMagic[4] = {'M', 'R', 'T', 'I'};
+static constexpr std::uint32_t kVersion = 1;
+
+namespace
+{
+
+template <typename T> void put(std::ofstream &out, T value)
+{
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> bool get(std::ifstream &in, T &value)
+{
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+// Events the game loop reacts to; anything else is not worth recording.
+bool recorded_type(Uint32 type)
+{
+        return type == SDL_QUIT || type == SDL_WINDOWEVENT || type == SDL_KEYDOWN ||
+               type == SDL_KEYUP || type == SDL_MOUSEMOTION || type == SDL_MOUSEBUTTONDOWN ||
+               type == SDL_MOUSEBUTTONUP || type == SDL_MOUSEWHEEL;
+}
+
+} // namespace
+
+bool InputRecorder::start_recording(const std::string &path, const Header &header)
+{
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+                std::cerr << "Failed to open input recording: " << path << "\n";
+                return false;
+        }
+        out.write(kMagic, sizeof(kMagic));
+        put<std::uint32_t>(out, kVersion);
+        put<std::int32_t>(out, header.width);
+        put<std::int32_t>(out, header.height);
+        put<std::uint8_t>(out, static_cast<std::uint8_t>(header.quality));
+        file_header = header;
+        file_path = path;
+        current_mode = Mode::Record;
+        return true;
+}
+
+bool InputRecorder::start_replay(const std::string &path)
+{
+        in.open(path, std::ios::binary);
+        char magic[4] = {};
+        std::uint32_t version = 0;
+        std::int32_t width = 0;
+        std::int32_t height = 0;
+        std::uint8_t quality = 0;
+        if (!in || !in.read(magic, sizeof(magic)) ||
+            std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || !get(in, version) ||
+            version != kVersion || !get(in, width) || !get(in, height) || !get(in, quality) ||
+            width <= 0 || height <= 0)
+        {
+                std::cerr << "Not a valid input recording: " << path << "\n";
+                in.close();
+                return false;
+        }
+        file_header.width = width;
+        file_header.height = height;
+        file_header.quality = static_cast<char>(quality);
+        file_path = path;
+        current_mode = Mode::Replay;
+        return true;
+}
+
+void InputRecorder::finish()
+{
+        if (current_mode == Mode::Record)
+        {
+                if (frame_open)
+                        write_frame();
+                out.close();
+                if (!out)
+                        std::cerr << "Failed to write input recording: " << file_path << "\n";
+                else
+                        std::cout << "Recorded " << trace_ms.size() << " frames to "
+                                  << file_path << "\n";
+        }
+        else if (current_mode == Mode::Replay)
+        {
+                in.close();
+                double total = 0.0;
+                for (double ms : trace_ms)
+                        total += ms;
+                std::vector<double> sorted = trace_ms;
+                std::sort(sorted.begin(), sorted.end());
+                double p95 = sorted.empty() ? 0.0 : sorted[(sorted.size() - 1) * 95 / 100];
+                std::cout << "Replayed " << trace_ms.size() << " frames from " << file_path
+                          << ": trace mean "
+                          << (trace_ms.empty() ? 0.0 : total / trace_ms.size())
+                          << " ms, p95 " << p95 << " ms\n";
+        }
+        current_mode = Mode::Off;
+        frame_open = false;
+        trace_ms.clear();
+}
+
+bool InputRecorder::begin_frame(double &dt)
+{
+        if (current_mode == Mode::Record)
+        {
+                if (frame_open)
+                        write_frame();
+                frame.dt = dt;
+                frame.keys.clear();
+                frame.events.clear();
+                frame_open = true;
+                return true;
+        }
+        if (current_mode == Mode::Replay)
+        {
+                if (!read_frame())
+                        return false;
+                dt = frame.dt;
+                std::fill(std::begin(keys), std::end(keys), 0);
+                for (std::uint16_t scancode : frame.keys)
+                        if (scancode < SDL_NUM_SCANCODES)
+                                keys[scancode] = 1;
+                next_event = 0;
+        }
+        return true;
+}
+
+void InputRecorder::end_frame(double trace)
+{
+        if (current_mode != Mode::Off)
+                trace_ms.push_back(trace);
+}
+
+bool InputRecorder::poll_event(SDL_Event &e)
+{
+        if (current_mode != Mode::Replay)
+        {
+                if (!SDL_PollEvent(&e))
+                        return false;
+                if (current_mode == Mode::Record && frame_open && recorded_type(e.type))
+                        frame.events.push_back(e);
+                return true;
+        }
+        // Live input is drained so the window stays responsive; only a
+        // request to close it gets through.
+        SDL_Event live;
+        while (SDL_PollEvent(&live))
+        {
+                if (live.type == SDL_QUIT)
+                {
+                        e = live;
+                        return true;
+                }
+        }
+        if (next_event >= frame.events.size())
+                return false;
+        e = frame.events[next_event++];
+        return true;
+}
+
+const Uint8 *InputRecorder::keyboard_state()
+{
+        if (current_mode == Mode::Replay)
+                return keys;
+        const Uint8 *state = SDL_GetKeyboardState(nullptr);
+        if (current_mode == Mode::Record && frame_open)
+        {
+                frame.keys.clear();
+                for (int scancode = 0; scancode < SDL_NUM_SCANCODES; ++scancode)
+                        if (state[scancode])
+                                frame.keys.push_back(static_cast<std::uint16_t>(scancode));
+        }
+        return state;
+}
+
+void InputRecorder::write_frame()
+{
+        put<double>(out, frame.dt);
+        put<std::uint16_t>(out, static_cast<std::uint16_t>(frame.keys.size()));
+        for (std::uint16_t scancode : frame.keys)
+                put<std::uint16_t>(out, scancode);
+        size_t count = std::min<size_t>(frame.events.size(), UINT16_MAX);
+        put<std::uint16_t>(out, static_cast<std::uint16_t>(count));
+        for (size_t i = 0; i < count; ++i)
+        {
+                const SDL_Event &e = frame.events[i];
+                put<std::uint32_t>(out, e.type);
+                put<std::uint32_t>(out, e.key.timestamp);
+                switch (e.type)
+                {
+                case SDL_WINDOWEVENT:
+                        put<std::uint8_t>(out, e.window.event);
+                        put<std::int32_t>(out, e.window.data1);
+                        put<std::int32_t>(out, e.window.data2);
+                        break;
+                case SDL_KEYDOWN:
+                case SDL_KEYUP:
+                        put<std::uint16_t>(out, static_cast<std::uint16_t>(e.key.keysym.scancode));
+                        put<std::int32_t>(out, e.key.keysym.sym);
+                        put<std::uint16_t>(out, e.key.keysym.mod);
+                        put<std::uint8_t>(out, e.key.state);
+                        put<std::uint8_t>(out, e.key.repeat);
+                        break;
+                case SDL_MOUSEMOTION:
+                        put<std::uint32_t>(out, e.motion.state);
+                        put<std::int32_t>(out, e.motion.x);
+                        put<std::int32_t>(out, e.motion.y);
+                        put<std::int32_t>(out, e.motion.xrel);
+                        put<std::int32_t>(out, e.motion.yrel);
+                        break;
+                case SDL_MOUSEBUTTONDOWN:
+                case SDL_MOUSEBUTTONUP:
+                        put<std::uint8_t>(out, e.button.button);
+                        put<std::uint8_t>(out, e.button.state);
+                        put<std::uint8_t>(out, e.button.clicks);
+                        put<std::int32_t>(out, e.button.x);
+                        put<std::int32_t>(out, e.button.y);
+                        break;
+                case SDL_MOUSEWHEEL:
+                        put<std::int32_t>(out, e.wheel.x);
+                        put<std::int32_t>(out, e.wheel.y);
+                        break;
+                default:
+                        break;
+                }
+        }
+        frame_open = false;
+}
+
+bool InputRecorder::read_frame()
+{
+        std::uint16_t key_count = 0;
+        std::uint16_t event_count = 0;
+        if (!get(in, frame.dt) || !get(in, key_count))
+                return false;
+        frame.keys.resize(key_count);
+        for (std::uint16_t &scancode : frame.keys)
+                if (!get(in, scancode))
+                        return false;
+        if (!get(in, event_count))
+                return false;
+        frame.events.assign(event_count, SDL_Event());
+        for (SDL_Event &e : frame.events)
+        {
+                std::memset(&e, 0, sizeof(e));
+                std::uint32_t type = 0;
+                std::uint32_t timestamp = 0;
+                if (!get(in, type) || !get(in, timestamp))
+                        return false;
+                bool ok = true;
+                switch (type)
+                {
+                case SDL_WINDOWEVENT:
+                        ok = get(in, e.window.event) && get(in, e.window.data1) &&
+                             get(in, e.window.data2);
+                        break;
+                case SDL_KEYDOWN:
+                case SDL_KEYUP:
+                {
+                        std::uint16_t scancode = 0;
+                        ok = get(in, scancode) && get(in, e.key.keysym.sym) &&
+                             get(in, e.key.keysym.mod) && get(in, e.key.state) &&
+                             get(in, e.key.repeat);
+                        e.key.keysym.scancode = static_cast<SDL_Scancode>(scancode);
+                        break;
+                }
+                case SDL_MOUSEMOTION:
+                        ok = get(in, e.motion.state) && get(in, e.motion.x) &&
+                             get(in, e.motion.y) && get(in, e.motion.xrel) &&
+                             get(in, e.motion.yrel);
+                        break;
+                case SDL_MOUSEBUTTONDOWN:
+                case SDL_MOUSEBUTTONUP:
+                        ok = get(in, e.button.button) && get(in, e.button.state) &&
+                             get(in, e.button.clicks) && get(in, e.button.x) &&
+                             get(in, e.button.y);
+                        break;
+                case SDL_MOUSEWHEEL:
+                        ok = get(in, e.wheel.x) && get(in, e.wheel.y);
+                        break;
+                default:
+                        break;
+                }
+                if (!ok)
+                        return false;
+                e.type = type;
+                e.key.timestamp = timestamp;
+        }
+        return true;
+}
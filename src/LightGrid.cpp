@@ -0,0 +1,193 @@
+#include "LightGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr int kCellsPerLight = 8;
+static constexpr int kMaxCells = 4096;
+static constexpr int kMaxAxisCells = 32;
+static constexpr double kMinExtent = 1e-3;
+
+static void expand(AABB &box, const Vec3 &p)
+{
+        box.min = Vec3(std::min(box.min.x, p.x), std::min(box.min.y, p.y),
+                       std::min(box.min.z, p.z));
+        box.max = Vec3(std::max(box.max.x, p.x), std::max(box.max.y, p.y),
+                       std::max(box.max.z, p.z));
+}
+
+// Largest value of the unit vectors within `half_angle` of `axis` along a
+// coordinate axis whose cosine to `axis` is `axis_cos`.
+static double cap_extent(double axis_cos, double half_angle)
+{
+        double angle = std::acos(std::clamp(axis_cos, -1.0, 1.0));
+        return std::cos(std::max(0.0, angle - half_angle));
+}
+
+bool LightGrid::light_bounds(const PointLight &L, AABB &out)
+{
+        if (L.range <= 0.0)
+                return false;
+        const Vec3 &P = L.position;
+        double dir_len = L.direction.length();
+        if (L.beam_spotlight && L.spot_radius > 0.0)
+        {
+                // Cylinder of spot_radius around the axis, from the source to
+                // range. A zero axis lights nothing, so an empty box is fine.
+                if (dir_len <= 1e-6)
+                {
+                        out = AABB(P, P);
+                        return true;
+                }
+                Vec3 a = L.direction / dir_len;
+                Vec3 end = P + a * L.range;
+                double r = L.spot_radius;
+                Vec3 pad(r * std::sqrt(std::max(0.0, 1.0 - a.x * a.x)),
+                         r * std::sqrt(std::max(0.0, 1.0 - a.y * a.y)),
+                         r * std::sqrt(std::max(0.0, 1.0 - a.z * a.z)));
+                out = AABB(P, P);
+                expand(out, end);
+                out.min = out.min - pad;
+                out.max = out.max + pad;
+                return true;
+        }
+        Vec3 reach(L.range, L.range, L.range);
+        out = AABB(P - reach, P + reach);
+        if (L.cutoff_cos <= -1.0 || dir_len <= 1e-6)
+                return true;
+        // The cone test compares against the raw direction, so the effective
+        // half angle depends on its length.
+        double cone_cos = L.cutoff_cos / dir_len;
+        if (cone_cos <= 0.0 || cone_cos >= 1.0)
+                return true;
+        // A cone narrower than a hemisphere is convex; its extremes are the
+        // apex or a point of the spherical cap at distance range.
+        double half_angle = std::acos(cone_cos);
+        Vec3 a = L.direction / dir_len;
+        Vec3 hi(cap_extent(a.x, half_angle), cap_extent(a.y, half_angle),
+                cap_extent(a.z, half_angle));
+        Vec3 lo(-cap_extent(-a.x, half_angle), -cap_extent(-a.y, half_angle),
+                -cap_extent(-a.z, half_angle));
+        out = AABB(P, P);
+        expand(out, P + lo * L.range);
+        expand(out, P + hi * L.range);
+        return true;
+}
+
+void LightGrid::cell_range(const AABB &box, int lo[3], int hi[3]) const
+{
+        const double mins[3] = {box.min.x - bounds.min.x, box.min.y - bounds.min.y,
+                                box.min.z - bounds.min.z};
+        const double maxs[3] = {box.max.x - bounds.min.x, box.max.y - bounds.min.y,
+                                box.max.z - bounds.min.z};
+        const double inv[3] = {inv_cell.x, inv_cell.y, inv_cell.z};
+        const int dims[3] = {nx, ny, nz};
+        for (int a = 0; a < 3; ++a)
+        {
+                lo[a] = std::clamp(static_cast<int>(std::floor(mins[a] * inv[a])), 0,
+                                   dims[a] - 1);
+                hi[a] = std::clamp(static_cast<int>(std::floor(maxs[a] * inv[a])), 0,
+                                   dims[a] - 1);
+        }
+}
+
+void LightGrid::build(const std::vector<PointLight> &lights)
+{
+        global_lights.clear();
+        cell_start.clear();
+        cell_lights.clear();
+        nx = ny = nz = 0;
+        prepared.clear();
+        prepared.reserve(lights.size());
+        for (const auto &L : lights)
+                prepared.push_back(prepare_light(L));
+
+        std::vector<AABB> boxes(lights.size());
+        std::vector<char> bounded(lights.size(), 0);
+        int bounded_count = 0;
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+                if (light_bounds(lights[i], boxes[i]))
+                {
+                        bounded[i] = 1;
+                        bounds = bounded_count ? AABB::surrounding_box(bounds, boxes[i])
+                                               : boxes[i];
+                        ++bounded_count;
+                }
+                else
+                {
+                        global_lights.push_back(static_cast<int>(i));
+                }
+        }
+        if (bounded_count == 0)
+                return;
+
+        Vec3 extent = bounds.max - bounds.min;
+        extent = Vec3(std::max(extent.x, kMinExtent), std::max(extent.y, kMinExtent),
+                      std::max(extent.z, kMinExtent));
+        bounds.max = bounds.min + extent;
+        int target = std::clamp(bounded_count * kCellsPerLight, 1, kMaxCells);
+        double cell = std::cbrt(extent.x * extent.y * extent.z / target);
+        auto cells_along = [cell](double len)
+        {
+                return std::clamp(static_cast<int>(std::ceil(len / cell)), 1, kMaxAxisCells);
+        };
+        nx = cells_along(extent.x);
+        ny = cells_along(extent.y);
+        nz = cells_along(extent.z);
+        inv_cell = Vec3(nx / extent.x, ny / extent.y, nz / extent.z);
+
+        // Counting pass, then a fill pass in light order so every cell
+        // lists its lights in the same order the scene does.
+        const int cell_count = nx * ny * nz;
+        std::vector<int> counts(cell_count, 0);
+        auto for_cells = [&](size_t i, auto &&fn)
+        {
+                if (!bounded[i])
+                {
+                        for (int c = 0; c < cell_count; ++c)
+                                fn(c);
+                        return;
+                }
+                int lo[3], hi[3];
+                cell_range(boxes[i], lo, hi);
+                for (int z = lo[2]; z <= hi[2]; ++z)
+                        for (int y = lo[1]; y <= hi[1]; ++y)
+                                for (int x = lo[0]; x <= hi[0]; ++x)
+                                        fn((z * ny + y) * nx + x);
+        };
+        for (size_t i = 0; i < lights.size(); ++i)
+                for_cells(i, [&](int c) { ++counts[c]; });
+        cell_start.resize(cell_count + 1);
+        cell_start[0] = 0;
+        for (int c = 0; c < cell_count; ++c)
+                cell_start[c + 1] = cell_start[c] + counts[c];
+        cell_lights.resize(cell_start[cell_count]);
+        std::vector<int> cursor(cell_start.begin(), cell_start.end() - 1);
+        for (size_t i = 0; i < lights.size(); ++i)
+                for_cells(i, [&](int c) { cell_lights[cursor[c]++] = static_cast<int>(i); });
+}
+
+int LightGrid::cell_of(const Vec3 &p) const
+{
+        if (nx == 0)
+                return -1;
+        if (p.x < bounds.min.x || p.y < bounds.min.y || p.z < bounds.min.z ||
+            p.x > bounds.max.x || p.y > bounds.max.y || p.z > bounds.max.z)
+                return -1;
+        int ix = std::min(static_cast<int>((p.x - bounds.min.x) * inv_cell.x), nx - 1);
+        int iy = std::min(static_cast<int>((p.y - bounds.min.y) * inv_cell.y), ny - 1);
+        int iz = std::min(static_cast<int>((p.z - bounds.min.z) * inv_cell.z), nz - 1);
+        return (iz * ny + iy) * nx + ix;
+}
+
+LightGrid::LightList LightGrid::lights_at(const Vec3 &p) const
+{
+        int c = cell_of(p);
+        if (c < 0)
+        {
+                const int *globals = global_lights.data();
+                return LightList{globals, globals + global_lights.size()};
+        }
+        const int *base = cell_lights.data();
+        return LightList{base + cell_start[c], base + cell_start[c + 1]};
+}
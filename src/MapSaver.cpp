@@ -10,13 +10,19 @@
 #include "Sphere.hpp"
 
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace
 {
@@ -146,12 +152,10 @@ struct CylinderRecord
 
 } // namespace
 
-bool MapSaver::save(const std::string &path, const Scene &scene, const Camera &camera,
-                                         const std::vector<Material> &materials)
+std::string MapSaver::serialize(const Scene &scene, const Camera &camera,
+                                const std::vector<Material> &materials)
 {
-        std::ofstream out(path);
-        if (!out)
-                return false;
+        std::ostringstream out;
 
         if (!scene.prompts.empty())
         {
@@ -388,6 +392,69 @@ bool MapSaver::save(const std::string &path, const Scene &scene, const Camera &c
                 out << "scorable = " << bool_str(target->scorable) << "\n\n";
         }
 
+        return out.str();
+}
+
+
+bool MapSaver::write_atomic(const std::string &path, const std::string &contents,
+                            std::error_code &ec)
+{
+        ec.clear();
+        std::string temp_path = path + ".tmp";
+#ifndef _WIN32
+        int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+                ec.assign(errno, std::generic_category());
+                return false;
+        }
+        const char *data = contents.data();
+        size_t left = contents.size();
+        while (left > 0 && !ec)
+        {
+                ssize_t n = ::write(fd, data, left);
+                if (n < 0 && errno != EINTR)
+                        ec.assign(errno, std::generic_category());
+                else if (n > 0)
+                {
+                        data += n;
+                        left -= static_cast<size_t>(n);
+                }
+        }
+        // The data must be on disk before the rename makes it the level.
+        if (!ec && ::fsync(fd) != 0)
+                ec.assign(errno, std::generic_category());
+        if (::close(fd) != 0 && !ec)
+                ec.assign(errno, std::generic_category());
+#else
+        {
+                std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+                out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+                out.close();
+                if (!out)
+                        ec = std::make_error_code(std::errc::io_error);
+        }
+#endif
+        if (!ec)
+                std::filesystem::rename(temp_path, path, ec);
+        if (ec)
+        {
+                std::error_code ignored;
+                std::filesystem::remove(temp_path, ignored);
+                return false;
+        }
         return true;
 }
 
+bool MapSaver::save(const std::string &path, const Scene &scene, const Camera &camera,
+                    const std::vector<Material> &materials, std::error_code &ec)
+{
+        return write_atomic(path, serialize(scene, camera, materials), ec);
+}
+
+bool MapSaver::save(const std::string &path, const Scene &scene, const Camera &camera,
+                    const std::vector<Material> &materials)
+{
+        std::error_code ec;
+        return save(path, scene, camera, materials, ec);
+}
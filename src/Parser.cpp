@@ -5,6 +5,7 @@
 #include "Cube.hpp"
 #include "Cylinder.hpp"
 #include "Plane.hpp"
+#include "SceneCache.hpp"
 #include "Sphere.hpp"
 
 #include <algorithm>
@@ -394,7 +395,33 @@ Material make_material(const std::array<int, 3> &rgb, bool reflective, bool tran
         return mat;
 }
 
-bool process_camera(const TableData &table, Vec3 &cam_pos, Vec3 &cam_dir, double &fov)
+void store_vec3(double (&out)[3], const Vec3 &v)
+{
+        out[0] = v.x;
+        out[1] = v.y;
+        out[2] = v.z;
+}
+
+Vec3 load_vec3(const double (&in)[3]) { return Vec3(in[0], in[1], in[2]); }
+
+void store_rgb(uint8_t (&out)[3], const std::array<int, 3> &rgb)
+{
+        for (int i = 0; i < 3; ++i)
+                out[i] = static_cast<uint8_t>(rgb[i]);
+}
+
+std::array<int, 3> load_rgb(const uint8_t (&in)[3]) { return {in[0], in[1], in[2]}; }
+
+uint8_t object_flags(bool reflective, bool transparent, bool rotatable, bool movable,
+                     bool scorable)
+{
+        return (reflective ? SceneRecord::Reflective : 0) |
+               (transparent ? SceneRecord::Transparent : 0) |
+               (rotatable ? SceneRecord::Rotatable : 0) | (movable ? SceneRecord::Movable : 0) |
+               (scorable ? SceneRecord::Scorable : 0);
+}
+
+bool process_camera(const TableData &table, SceneRecord &rec)
 {
         if (!check_allowed_keys(table, {"id", "position", "lookdir", "fov"}))
                 return false;
@@ -411,18 +438,21 @@ bool process_camera(const TableData &table, Vec3 &cam_pos, Vec3 &cam_dir, double
                 return false;
         if (!ensure_non_zero(lookdir, table.values.at("lookdir").second, "lookdir", table.type))
                 return false;
+        double fov;
         if (!parse_double_range_field(table, "fov", fov, 0.0, 180.0))
                 return false;
         if (!(fov > 0.0 && fov < 180.0))
                 return report_error(table.values.at("fov").second, "Camera FOV must be in (0, 180)");
         if (!std::isfinite(position.x) || !std::isfinite(position.y) || !std::isfinite(position.z))
                 return report_error(table.values.at("position").second, "Camera position must be finite");
-        cam_pos = position;
-        cam_dir = lookdir.normalized();
+        rec.kind = SceneRecord::Camera;
+        store_vec3(rec.position, position);
+        store_vec3(rec.dir, lookdir);
+        rec.a = fov;
         return true;
 }
 
-bool process_lighting_ambient(const TableData &table, Scene &scene)
+bool process_lighting_ambient(const TableData &table, SceneRecord &rec)
 {
         if (!check_allowed_keys(table, {"intensity", "color"}))
                 return false;
@@ -432,11 +462,13 @@ bool process_lighting_ambient(const TableData &table, Scene &scene)
         std::array<int, 3> rgb;
         if (!parse_color_field(table, "color", rgb))
                 return false;
-        scene.ambient = Ambient(rgb_to_unit(rgb), intensity);
+        rec.kind = SceneRecord::Ambient;
+        store_rgb(rec.rgb, rgb);
+        rec.a = intensity;
         return true;
 }
 
-bool process_lighting_light_source(const TableData &table, Scene &scene,
+bool process_lighting_light_source(const TableData &table, SceneRecord &rec,
                                    std::unordered_set<std::string> &light_ids)
 {
         if (!check_allowed_keys(table, {"id", "intensity", "position", "color"}))
@@ -459,12 +491,15 @@ bool process_lighting_light_source(const TableData &table, Scene &scene,
         std::array<int, 3> rgb;
         if (!parse_color_field(table, "color", rgb))
                 return false;
-        scene.lights.emplace_back(position, rgb_to_unit(rgb), intensity);
+        rec.kind = SceneRecord::Light;
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        rec.a = intensity;
         return true;
 }
 
-bool process_plane(const TableData &table, Scene &scene, int &oid, int &mid,
-                   std::vector<Material> &materials, std::unordered_set<std::string> &object_ids)
+bool process_plane(const TableData &table, SceneRecord &rec,
+                   std::unordered_set<std::string> &object_ids)
 {
         if (!check_allowed_keys(table,
                                 {"id", "color", "position", "dir", "reflective", "rotatable",
@@ -505,18 +540,16 @@ bool process_plane(const TableData &table, Scene &scene, int &oid, int &mid,
         bool transparent;
         if (!parse_bool_field(table, "transparent", transparent))
                 return false;
-        auto plane = std::make_shared<Plane>(position, normal.normalized(), oid++, mid);
-        plane->movable = movable;
-        plane->scorable = scorable;
-        Material mat = make_material(rgb, reflective, transparent);
-        materials.push_back(mat);
-        scene.objects.push_back(plane);
-        ++mid;
+        rec.kind = SceneRecord::Plane;
+        rec.flags = object_flags(reflective, transparent, false, movable, scorable);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        store_vec3(rec.dir, normal);
         return true;
 }
 
-bool process_sphere(const TableData &table, Scene &scene, int &oid, int &mid,
-                    std::vector<Material> &materials, std::unordered_set<std::string> &object_ids)
+bool process_sphere(const TableData &table, SceneRecord &rec,
+                    std::unordered_set<std::string> &object_ids)
 {
         if (!check_allowed_keys(table,
                                 {"id", "color", "position", "dir", "radius", "reflective",
@@ -554,19 +587,16 @@ bool process_sphere(const TableData &table, Scene &scene, int &oid, int &mid,
         bool transparent;
         if (!parse_bool_field(table, "transparent", transparent))
                 return false;
-        auto sphere = std::make_shared<Sphere>(position, radius, oid++, mid);
-        sphere->rotatable = rotatable;
-        sphere->movable = movable;
-        sphere->scorable = scorable;
-        Material mat = make_material(rgb, reflective, transparent);
-        materials.push_back(mat);
-        scene.objects.push_back(sphere);
-        ++mid;
+        rec.kind = SceneRecord::Sphere;
+        rec.flags = object_flags(reflective, transparent, rotatable, movable, scorable);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        rec.a = radius;
         return true;
 }
 
-bool process_cube(const TableData &table, Scene &scene, int &oid, int &mid,
-                  std::vector<Material> &materials, std::unordered_set<std::string> &object_ids)
+bool process_cube(const TableData &table, SceneRecord &rec,
+                  std::unordered_set<std::string> &object_ids)
 {
         if (!check_allowed_keys(table,
                                 {"id", "color", "position", "dir", "width", "height", "length",
@@ -613,19 +643,19 @@ bool process_cube(const TableData &table, Scene &scene, int &oid, int &mid,
         bool transparent;
         if (!parse_bool_field(table, "transparent", transparent))
                 return false;
-        auto cube = std::make_shared<Cube>(position, dir.normalized(), length, width, height, oid++, mid);
-        cube->rotatable = rotatable;
-        cube->movable = movable;
-        cube->scorable = scorable;
-        Material mat = make_material(rgb, reflective, transparent);
-        materials.push_back(mat);
-        scene.objects.push_back(cube);
-        ++mid;
+        rec.kind = SceneRecord::Cube;
+        rec.flags = object_flags(reflective, transparent, rotatable, movable, scorable);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        store_vec3(rec.dir, dir);
+        rec.a = length;
+        rec.b = width;
+        rec.c = height;
         return true;
 }
 
-bool process_cylinder(const TableData &table, Scene &scene, int &oid, int &mid,
-                      std::vector<Material> &materials, std::unordered_set<std::string> &object_ids)
+bool process_cylinder(const TableData &table, SceneRecord &rec,
+                      std::unordered_set<std::string> &object_ids)
 {
         if (!check_allowed_keys(table,
                                 {"id", "color", "position", "dir", "radius", "height",
@@ -669,19 +699,18 @@ bool process_cylinder(const TableData &table, Scene &scene, int &oid, int &mid,
         bool transparent;
         if (!parse_bool_field(table, "transparent", transparent))
                 return false;
-        auto cylinder = std::make_shared<Cylinder>(position, dir.normalized(), radius, height, oid++, mid);
-        cylinder->rotatable = rotatable;
-        cylinder->movable = movable;
-        cylinder->scorable = scorable;
-        Material mat = make_material(rgb, reflective, transparent);
-        materials.push_back(mat);
-        scene.objects.push_back(cylinder);
-        ++mid;
+        rec.kind = SceneRecord::Cylinder;
+        rec.flags = object_flags(reflective, transparent, rotatable, movable, scorable);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        store_vec3(rec.dir, dir);
+        rec.a = radius;
+        rec.b = height;
         return true;
 }
 
-bool process_cone(const TableData &table, Scene &scene, int &oid, int &mid,
-                  std::vector<Material> &materials, std::unordered_set<std::string> &object_ids)
+bool process_cone(const TableData &table, SceneRecord &rec,
+                  std::unordered_set<std::string> &object_ids)
 {
         if (!check_allowed_keys(table,
                                 {"id", "color", "position", "dir", "radius", "height",
@@ -725,19 +754,17 @@ bool process_cone(const TableData &table, Scene &scene, int &oid, int &mid,
         bool transparent;
         if (!parse_bool_field(table, "transparent", transparent))
                 return false;
-        auto cone = std::make_shared<Cone>(position, dir.normalized(), radius, height, oid++, mid);
-        cone->rotatable = rotatable;
-        cone->movable = movable;
-        cone->scorable = scorable;
-        Material mat = make_material(rgb, reflective, transparent);
-        materials.push_back(mat);
-        scene.objects.push_back(cone);
-        ++mid;
+        rec.kind = SceneRecord::Cone;
+        rec.flags = object_flags(reflective, transparent, rotatable, movable, scorable);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        store_vec3(rec.dir, dir);
+        rec.a = radius;
+        rec.b = height;
         return true;
 }
 
-bool process_beam_source(const TableData &table, Scene &scene, int &oid, int &mid,
-                         std::vector<Material> &materials,
+bool process_beam_source(const TableData &table, SceneRecord &rec,
                          std::unordered_set<std::string> &beam_ids)
 {
         if (!check_allowed_keys(table,
@@ -784,6 +811,176 @@ bool process_beam_source(const TableData &table, Scene &scene, int &oid, int &mi
         bool with_laser;
         if (!parse_bool_field(table, "with_laser", with_laser))
                 return false;
+        rec.kind = SceneRecord::BeamSource;
+        rec.flags = object_flags(false, false, rotatable, movable, scorable) |
+                    (with_laser ? SceneRecord::WithLaser : 0);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        store_vec3(rec.dir, dir);
+        rec.a = intensity;
+        rec.b = source_radius;
+        rec.c = length;
+        return true;
+}
+
+bool process_beam_target(const TableData &table, SceneRecord &rec,
+                         std::unordered_set<std::string> &target_ids)
+{
+        if (!check_allowed_keys(table,
+                                {"id", "position", "color", "radius", "movable", "scorable"}))
+                return false;
+        std::string id;
+        if (!parse_string_field(table, "id", id))
+                return false;
+        if (!target_ids.insert(id).second)
+                return report_error(table.values.at("id").second, "Duplicate beam target id '" + id + "'");
+        Vec3 position;
+        if (!parse_vec3_field(table, "position", position))
+                return false;
+        double radius;
+        if (!parse_positive_double_field(table, "radius", radius))
+                return false;
+        std::array<int, 3> rgb;
+        if (!parse_color_field(table, "color", rgb))
+                return false;
+        bool movable;
+        if (!parse_bool_field(table, "movable", movable))
+                return false;
+        bool scorable;
+        if (!parse_bool_field(table, "scorable", scorable))
+                return false;
+
+        rec.kind = SceneRecord::BeamTarget;
+        rec.flags = object_flags(false, false, false, movable, scorable);
+        store_rgb(rec.rgb, rgb);
+        store_vec3(rec.position, position);
+        rec.a = radius;
+        return true;
+}
+
+bool process_prompts(const TableData &table, std::vector<std::string> &prompts)
+{
+        prompts.clear();
+        for (const auto &key : table.order)
+        {
+                auto it = table.values.find(key);
+                if (it == table.values.end())
+                        continue;
+                std::string trimmed = trim(it->second.first);
+                size_t line = it->second.second;
+                if (trimmed.size() < 2 || trimmed.front() != '"' || trimmed.back() != '"')
+                        return report_error(line, "Expected string for '" + key + "'");
+                std::string inner = trimmed.substr(1, trimmed.size() - 2);
+                std::string value;
+                value.reserve(inner.size());
+                for (size_t i = 0; i < inner.size(); ++i)
+                {
+                        char ch = inner[i];
+                        if (ch == '\\')
+                        {
+                                if (i + 1 >= inner.size())
+                                        return report_error(line, "Invalid escape sequence in prompt value");
+                                char next = inner[++i];
+                                switch (next)
+                                {
+                                case 'n':
+                                        value.push_back('\n');
+                                        break;
+                                case 'r':
+                                        value.push_back('\n');
+                                        break;
+                                case 't':
+                                        value.push_back('\t');
+                                        break;
+                                case '\\':
+                                        value.push_back('\\');
+                                        break;
+                                case '"':
+                                        value.push_back('"');
+                                        break;
+                                default:
+                                        return report_error(line, std::string("Unsupported escape sequence \\") + next + " in prompt value");
+                                }
+                        }
+                        else
+                        {
+                                value.push_back(ch);
+                        }
+                }
+                prompts.push_back(std::move(value));
+        }
+        if (prompts.empty())
+                return report_error(table.header_line, "[prompts] must define at least one entry");
+        return true;
+}
+
+bool process_quota(const TableData &table, SceneRecord &rec)
+{
+        if (!check_allowed_keys(table, {"target", "minimal_score"}))
+                return false;
+        bool target = false;
+        if (!parse_bool_field(table, "target", target))
+                return false;
+        double minimal = 0.0;
+        if (!parse_non_negative_double_field(table, "minimal_score", minimal))
+                return false;
+        rec.kind = SceneRecord::Quota;
+        rec.flags = target ? SceneRecord::TargetRequired : 0;
+        rec.a = minimal;
+        return true;
+}
+
+// Everything below turns validated records into the scene. A parsed file
+// and a cached one both go through it, so ids, materials and lights come
+// out the same either way.
+
+void build_solid(const SceneRecord &rec, Scene &scene, int &oid, int &mid,
+                 std::vector<Material> &materials)
+{
+        Vec3 position = load_vec3(rec.position);
+        Vec3 dir = load_vec3(rec.dir);
+        HittablePtr object;
+        switch (rec.kind)
+        {
+        case SceneRecord::Plane:
+                object = std::make_shared<Plane>(position, dir.normalized(), oid++, mid);
+                break;
+        case SceneRecord::Sphere:
+                object = std::make_shared<Sphere>(position, rec.a, oid++, mid);
+                break;
+        case SceneRecord::Cube:
+                object = std::make_shared<Cube>(position, dir.normalized(), rec.a, rec.b, rec.c, oid++, mid);
+                break;
+        case SceneRecord::Cylinder:
+                object = std::make_shared<Cylinder>(position, dir.normalized(), rec.a, rec.b, oid++, mid);
+                break;
+        default:
+                object = std::make_shared<Cone>(position, dir.normalized(), rec.a, rec.b, oid++, mid);
+                break;
+        }
+        object->rotatable = rec.has(SceneRecord::Rotatable);
+        object->movable = rec.has(SceneRecord::Movable);
+        object->scorable = rec.has(SceneRecord::Scorable);
+        Material mat = make_material(load_rgb(rec.rgb), rec.has(SceneRecord::Reflective),
+                                     rec.has(SceneRecord::Transparent));
+        materials.push_back(mat);
+        scene.objects.push_back(object);
+        ++mid;
+}
+
+void build_beam_source(const SceneRecord &rec, Scene &scene, int &oid, int &mid,
+                       std::vector<Material> &materials)
+{
+        Vec3 position = load_vec3(rec.position);
+        Vec3 dir = load_vec3(rec.dir);
+        std::array<int, 3> rgb = load_rgb(rec.rgb);
+        double intensity = rec.a;
+        double source_radius = rec.b;
+        double length = rec.c;
+        bool movable = rec.has(SceneRecord::Movable);
+        bool rotatable = rec.has(SceneRecord::Rotatable);
+        bool scorable = rec.has(SceneRecord::Scorable);
+        bool with_laser = rec.has(SceneRecord::WithLaser);
         Vec3 color_unit = rgb_to_unit(rgb);
         double beam_radius = source_radius * 0.5;
 
@@ -858,36 +1055,16 @@ bool process_beam_source(const TableData &table, Scene &scene, int &oid, int &mi
                                           beam->source->object_id, dir_norm, cone_cos, length,
                                           false, true, spot_radius);
         }
-        return true;
 }
 
-bool process_beam_target(const TableData &table, Scene &scene, int &oid, int &mid,
-                         std::vector<Material> &materials,
-                         std::unordered_set<std::string> &target_ids)
+void build_beam_target(const SceneRecord &rec, Scene &scene, int &oid, int &mid,
+                       std::vector<Material> &materials)
 {
-        if (!check_allowed_keys(table,
-                                {"id", "position", "color", "radius", "movable", "scorable"}))
-                return false;
-        std::string id;
-        if (!parse_string_field(table, "id", id))
-                return false;
-        if (!target_ids.insert(id).second)
-                return report_error(table.values.at("id").second, "Duplicate beam target id '" + id + "'");
-        Vec3 position;
-        if (!parse_vec3_field(table, "position", position))
-                return false;
-        double radius;
-        if (!parse_positive_double_field(table, "radius", radius))
-                return false;
-        std::array<int, 3> rgb;
-        if (!parse_color_field(table, "color", rgb))
-                return false;
-        bool movable;
-        if (!parse_bool_field(table, "movable", movable))
-                return false;
-        bool scorable;
-        if (!parse_bool_field(table, "scorable", scorable))
-                return false;
+        Vec3 position = load_vec3(rec.position);
+        std::array<int, 3> rgb = load_rgb(rec.rgb);
+        double radius = rec.a;
+        bool movable = rec.has(SceneRecord::Movable);
+        bool scorable = rec.has(SceneRecord::Scorable);
 
         Vec3 color_unit = rgb_to_unit(rgb);
 
@@ -915,86 +1092,11 @@ bool process_beam_target(const TableData &table, Scene &scene, int &oid, int &mi
         target->mid.scorable = scorable;
         target->inner.scorable = scorable;
         scene.objects.push_back(target);
-        return true;
-}
-
-bool process_prompts(const TableData &table, Scene &scene)
-{
-        scene.prompts.clear();
-        for (const auto &key : table.order)
-        {
-                auto it = table.values.find(key);
-                if (it == table.values.end())
-                        continue;
-                std::string trimmed = trim(it->second.first);
-                size_t line = it->second.second;
-                if (trimmed.size() < 2 || trimmed.front() != '"' || trimmed.back() != '"')
-                        return report_error(line, "Expected string for '" + key + "'");
-                std::string inner = trimmed.substr(1, trimmed.size() - 2);
-                std::string value;
-                value.reserve(inner.size());
-                for (size_t i = 0; i < inner.size(); ++i)
-                {
-                        char ch = inner[i];
-                        if (ch == '\\')
-                        {
-                                if (i + 1 >= inner.size())
-                                        return report_error(line, "Invalid escape sequence in prompt value");
-                                char next = inner[++i];
-                                switch (next)
-                                {
-                                case 'n':
-                                        value.push_back('\n');
-                                        break;
-                                case 'r':
-                                        value.push_back('\n');
-                                        break;
-                                case 't':
-                                        value.push_back('\t');
-                                        break;
-                                case '\\':
-                                        value.push_back('\\');
-                                        break;
-                                case '"':
-                                        value.push_back('"');
-                                        break;
-                                default:
-                                        return report_error(line, std::string("Unsupported escape sequence \\") + next + " in prompt value");
-                                }
-                        }
-                        else
-                        {
-                                value.push_back(ch);
-                        }
-                }
-                scene.prompts.push_back(std::move(value));
-        }
-        if (scene.prompts.empty())
-                return report_error(table.header_line, "[prompts] must define at least one entry");
-        return true;
 }
 
-bool process_quota(const TableData &table, Scene &scene)
-{
-        if (!check_allowed_keys(table, {"target", "minimal_score"}))
-                return false;
-        bool target = false;
-        if (!parse_bool_field(table, "target", target))
-                return false;
-        double minimal = 0.0;
-        if (!parse_non_negative_double_field(table, "minimal_score", minimal))
-                return false;
-        scene.target_required = target;
-        scene.minimal_score = minimal;
-        return true;
-}
-
-} // namespace
-
-std::vector<Material> Parser::materials;
-
-bool Parser::parse_rt_file(const std::string &path, Scene &outScene,
-                                                   Camera &outCamera, int width, int height)
+// Checks a level file and records its tables in order, without building
+// anything.
+bool read_scene_file(const std::string &path, SceneSnapshot &snapshot)
 {
         std::ifstream in(path);
         if (!in)
@@ -1003,18 +1105,7 @@ bool Parser::parse_rt_file(const std::string &path, Scene &outScene,
                 return false;
         }
 
-        materials.clear();
-        outScene.objects.clear();
-        outScene.lights.clear();
-        outScene.accel.reset();
-        outScene.ambient = Ambient(Vec3(1, 1, 1), 0.0);
-        outScene.target_required = false;
-        outScene.minimal_score = 0.0;
-        outScene.prompts.clear();
-
-        Vec3 cam_pos(0, 0, -10);
         Vec3 cam_dir(0, 0, 1);
-        double fov = 60.0;
         bool camera_seen = false;
         bool ambient_seen = false;
         bool camera_declared = false;
@@ -1024,9 +1115,7 @@ bool Parser::parse_rt_file(const std::string &path, Scene &outScene,
         bool prompts_declared = false;
         bool prompts_seen = false;
         size_t quota_line = 0;
-
-        int oid = 0;
-        int mid = 0;
+        bool target_required = false;
 
         std::unordered_set<std::string> object_ids;
         std::unordered_set<std::string> light_ids;
@@ -1042,53 +1131,61 @@ bool Parser::parse_rt_file(const std::string &path, Scene &outScene,
                 if (table.type == TableType::None)
                         return true;
                 bool ok = false;
+                bool has_record = true;
+                SceneRecord rec;
                 switch (table.type)
                 {
                 case TableType::Camera:
-                        ok = process_camera(table, cam_pos, cam_dir, fov);
+                        ok = process_camera(table, rec);
                         camera_seen = ok;
+                        if (ok)
+                                cam_dir = load_vec3(rec.dir).normalized();
                         break;
                 case TableType::LightingAmbient:
-                        ok = process_lighting_ambient(table, outScene);
+                        ok = process_lighting_ambient(table, rec);
                         ambient_seen = ambient_seen || ok;
                         break;
                 case TableType::LightingLightSource:
-                        ok = process_lighting_light_source(table, outScene, light_ids);
+                        ok = process_lighting_light_source(table, rec, light_ids);
                         break;
                 case TableType::ObjectsPlane:
-                        ok = process_plane(table, outScene, oid, mid, materials, object_ids);
+                        ok = process_plane(table, rec, object_ids);
                         break;
                 case TableType::ObjectsSphere:
-                        ok = process_sphere(table, outScene, oid, mid, materials, object_ids);
+                        ok = process_sphere(table, rec, object_ids);
                         break;
                 case TableType::ObjectsCube:
-                        ok = process_cube(table, outScene, oid, mid, materials, object_ids);
+                        ok = process_cube(table, rec, object_ids);
                         break;
                 case TableType::ObjectsCone:
-                        ok = process_cone(table, outScene, oid, mid, materials, object_ids);
+                        ok = process_cone(table, rec, object_ids);
                         break;
                 case TableType::ObjectsCylinder:
-                        ok = process_cylinder(table, outScene, oid, mid, materials, object_ids);
+                        ok = process_cylinder(table, rec, object_ids);
                         break;
                 case TableType::BeamSource:
-                        ok = process_beam_source(table, outScene, oid, mid, materials, beam_source_ids);
+                        ok = process_beam_source(table, rec, beam_source_ids);
                         break;
                 case TableType::BeamTarget:
-                        ok = process_beam_target(table, outScene, oid, mid, materials, beam_target_ids);
+                        ok = process_beam_target(table, rec, beam_target_ids);
                         break;
                 case TableType::Prompts:
-                        ok = process_prompts(table, outScene);
+                        ok = process_prompts(table, snapshot.prompts);
                         prompts_seen = prompts_seen || ok;
+                        has_record = false;
                         break;
                 case TableType::Quota:
                         quota_line = table.header_line;
-                        ok = process_quota(table, outScene);
+                        ok = process_quota(table, rec);
                         quota_seen = quota_seen || ok;
+                        target_required = ok && rec.has(SceneRecord::TargetRequired);
                         break;
                 default:
                         ok = false;
                         break;
                 }
+                if (ok && has_record)
+                        snapshot.records.push_back(rec);
                 table = TableData{};
                 return ok;
         };
@@ -1237,14 +1334,85 @@ bool Parser::parse_rt_file(const std::string &path, Scene &outScene,
         if (cam_dir.length_squared() == 0.0)
                 return report_error(line_no ? line_no : 1, "Camera look direction cannot be zero");
 
-        if (outScene.target_required && beam_target_ids.empty())
+        if (target_required && beam_target_ids.empty())
         {
                 size_t err_line = quota_line ? quota_line : (line_no ? line_no : 1);
                 return report_error(err_line, "[quota] target is true but no beam.targets are defined");
         }
+        return true;
+}
+
+void build_scene(const SceneSnapshot &snapshot, Scene &scene, Camera &camera,
+                 std::vector<Material> &materials, int width, int height)
+{
+        materials.clear();
+        scene.objects.clear();
+        scene.lights.clear();
+        scene.accel.reset();
+        scene.ambient = Ambient(Vec3(1, 1, 1), 0.0);
+        scene.target_required = false;
+        scene.minimal_score = 0.0;
+        scene.prompts = snapshot.prompts;
+
+        int oid = 0;
+        int mid = 0;
+        for (const SceneRecord &rec : snapshot.records)
+        {
+                switch (rec.kind)
+                {
+                case SceneRecord::Camera:
+                {
+                        Vec3 cam_pos = load_vec3(rec.position);
+                        Vec3 cam_dir = load_vec3(rec.dir).normalized();
+                        camera = Camera(cam_pos, cam_pos + cam_dir.normalized(), rec.a,
+                                        double(width) / double(height));
+                        break;
+                }
+                case SceneRecord::Ambient:
+                        scene.ambient = Ambient(rgb_to_unit(load_rgb(rec.rgb)), rec.a);
+                        break;
+                case SceneRecord::Light:
+                        scene.lights.emplace_back(load_vec3(rec.position), rgb_to_unit(load_rgb(rec.rgb)),
+                                                  rec.a);
+                        break;
+                case SceneRecord::BeamSource:
+                        build_beam_source(rec, scene, oid, mid, materials);
+                        break;
+                case SceneRecord::BeamTarget:
+                        build_beam_target(rec, scene, oid, mid, materials);
+                        break;
+                case SceneRecord::Quota:
+                        scene.target_required = rec.has(SceneRecord::TargetRequired);
+                        scene.minimal_score = rec.a;
+                        break;
+                default:
+                        build_solid(rec, scene, oid, mid, materials);
+                        break;
+                }
+        }
+}
+
+} // namespace
 
-        outCamera = Camera(cam_pos, cam_pos + cam_dir.normalized(), fov,
-                           double(width) / double(height));
+std::vector<Material> Parser::materials;
+
+bool Parser::parse_rt_file(const std::string &path, Scene &outScene,
+                                                   Camera &outCamera, int width, int height)
+{
+        // Stamped before reading, so an edit that lands mid-parse leaves the
+        // cache stale rather than wrongly fresh.
+        SceneSourceStamp stamp;
+        bool stamped = scene_cache::stamp(path, stamp);
+        SceneSnapshot snapshot;
+        if (!stamped || !scene_cache::load(path, stamp, snapshot))
+        {
+                snapshot = SceneSnapshot{};
+                if (!read_scene_file(path, snapshot))
+                        return false;
+                if (stamped)
+                        scene_cache::save(path, stamp, snapshot);
+        }
+        build_scene(snapshot, outScene, outCamera, materials, width, height);
         return true;
 }
 
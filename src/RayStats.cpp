@@ -0,0 +1,172 @@
+#include "RayStats.hpp"
+#include <atomic>
+
+unsigned long long RayCounters::total_rays() const
+{
+	unsigned long long sum = 0;
+	for (unsigned long long n : rays)
+		sum += n;
+	return sum;
+}
+
+unsigned long long RayCounters::total_primitive_tests() const
+{
+	unsigned long long sum = 0;
+	for (unsigned long long n : primitive_tests)
+		sum += n;
+	return sum;
+}
+
+RayCounters &RayCounters::operator+=(const RayCounters &o)
+{
+	for (int i = 0; i < kRayKinds; ++i)
+		rays[i] += o.rays[i];
+	nodes += o.nodes;
+	box_tests += o.box_tests;
+	for (int i = 0; i < kShapeTypes; ++i)
+		primitive_tests[i] += o.primitive_tests[i];
+	return *this;
+}
+
+void RayCounters::write_csv_header(std::ostream &out)
+{
+	out << "frame";
+	for (int i = 0; i < kRayKinds; ++i)
+		out << "," << ray_kind_name(static_cast<RayKind>(i)) << "_rays";
+	out << ",bvh_nodes,box_tests";
+	for (int i = 0; i < kShapeTypes; ++i)
+		out << "," << shape_type_name(static_cast<ShapeType>(i)) << "_tests";
+	out << "\n";
+}
+
+void RayCounters::write_csv(std::ostream &out, int frame) const
+{
+	out << frame;
+	for (unsigned long long n : rays)
+		out << "," << n;
+	out << "," << nodes << "," << box_tests;
+	for (unsigned long long n : primitive_tests)
+		out << "," << n;
+	out << "\n";
+}
+
+void RayCounters::write_json(std::ostream &out) const
+{
+	out << "{\"rays\": {";
+	for (int i = 0; i < kRayKinds; ++i)
+		out << (i ? ", " : "") << "\"" << ray_kind_name(static_cast<RayKind>(i))
+			<< "\": " << rays[i];
+	out << "}, \"bvh_nodes\": " << nodes << ", \"box_tests\": " << box_tests
+		<< ", \"primitive_tests\": {";
+	for (int i = 0; i < kShapeTypes; ++i)
+		out << (i ? ", " : "") << "\"" << shape_type_name(static_cast<ShapeType>(i))
+			<< "\": " << primitive_tests[i];
+	out << "}}";
+}
+
+const char *ray_kind_name(RayKind kind)
+{
+	switch (kind)
+	{
+	case RayKind::Primary:
+		return "primary";
+	case RayKind::Shadow:
+		return "shadow";
+	case RayKind::Mirror:
+		return "mirror";
+	case RayKind::Transparency:
+		return "transparency";
+	case RayKind::Beam:
+		return "beam";
+	case RayKind::Score:
+		return "score";
+	default:
+		return "unknown";
+	}
+}
+
+const char *shape_type_name(ShapeType type)
+{
+	switch (type)
+	{
+	case ShapeType::Sphere:
+		return "sphere";
+	case ShapeType::Cube:
+		return "cube";
+	case ShapeType::Cylinder:
+		return "cylinder";
+	case ShapeType::Cone:
+		return "cone";
+	case ShapeType::Plane:
+		return "plane";
+	case ShapeType::BVH:
+		return "bvh";
+	case ShapeType::Beam:
+		return "beam";
+	case ShapeType::BeamTarget:
+		return "beam_target";
+	default:
+		return "generic";
+	}
+}
+
+#ifdef MINIRT_RAY_STATS
+namespace
+{
+
+struct AtomicCounters
+{
+	std::atomic<unsigned long long> rays[kRayKinds] = {};
+	std::atomic<unsigned long long> nodes{0};
+	std::atomic<unsigned long long> box_tests{0};
+	std::atomic<unsigned long long> primitive_tests[kShapeTypes] = {};
+};
+
+AtomicCounters totals;
+
+void add(std::atomic<unsigned long long> &to, unsigned long long &from)
+{
+	if (from)
+		to.fetch_add(from, std::memory_order_relaxed);
+	from = 0;
+}
+
+} // namespace
+
+namespace ray_stats
+{
+
+void flush()
+{
+	for (int i = 0; i < kRayKinds; ++i)
+		add(totals.rays[i], local.rays[i]);
+	add(totals.nodes, local.nodes);
+	add(totals.box_tests, local.box_tests);
+	for (int i = 0; i < kShapeTypes; ++i)
+		add(totals.primitive_tests[i], local.primitive_tests[i]);
+}
+
+void begin_frame()
+{
+	for (auto &n : totals.rays)
+		n.store(0, std::memory_order_relaxed);
+	totals.nodes.store(0, std::memory_order_relaxed);
+	totals.box_tests.store(0, std::memory_order_relaxed);
+	for (auto &n : totals.primitive_tests)
+		n.store(0, std::memory_order_relaxed);
+}
+
+RayCounters frame_totals()
+{
+	RayCounters out;
+	for (int i = 0; i < kRayKinds; ++i)
+		out.rays[i] = totals.rays[i].load(std::memory_order_relaxed);
+	out.nodes = totals.nodes.load(std::memory_order_relaxed);
+	out.box_tests = totals.box_tests.load(std::memory_order_relaxed);
+	for (int i = 0; i < kShapeTypes; ++i)
+		out.primitive_tests[i] = totals.primitive_tests[i].load(std::memory_order_relaxed);
+	return out;
+}
+
+} // namespace ray_stats
+#endif
@@ -1,5 +1,6 @@
 #include "Renderer.hpp"
 #include "AABB.hpp"
+#include "AutoSaver.hpp"
 #include "GameSession.hpp"
 #include "CommandLine.hpp"
 #include "Beam.hpp"
@@ -12,12 +13,18 @@
 #include "LevelFinishedMenu.hpp"
 #include "PauseMenu.hpp"
 #include "Laser.hpp"
+#include "LightGrid.hpp"
 #include "Plane.hpp"
+#include "RayStats.hpp"
+#include "Shading.hpp"
 #include "Sphere.hpp"
 #include "Cube.hpp"
 #include "Cone.hpp"
 #include "Cylinder.hpp"
 #include "CustomCharacter.hpp"
+#include "FrameProfiler.hpp"
+#include "ImageWriter.hpp"
+#include "InputRecorder.hpp"
 #include <SDL.h>
 #include <algorithm>
 #include <array>
@@ -26,79 +33,40 @@
 #include <cstdio>
 #include <cstring>
 #include <cctype>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <optional>
-#include <random>
 #include <system_error>
 #include <string>
 #include <thread>
 #include <utility>
 
-static inline Vec3 mix_colors(const Vec3 &a, const Vec3 &b, double alpha)
-{
-        return a * (1.0 - alpha) + b * alpha;
-}
-
-static constexpr double kObjectAltColorAmount = 0.35;
-static constexpr double kPlaneAltColorAmount = 0.05;
-static constexpr double kObjectCheckerFrequency = 5.0;
-static constexpr double kPlaneCheckerFrequency = 0.25;
 static constexpr double kQuotaScoreEpsilon = 1e-3;
 static constexpr double kBeamTransparentAlpha = 125.0 / 255.0;
 static constexpr double kSpotlightLaserRatio = 20.0;
 static constexpr Uint32 kTutorialContinueDelayMs = 4000;
-
-static Vec3 brighten_color_by(const Vec3 &color, double amount)
-{
-        return Vec3(std::clamp(color.x + (1.0 - color.x) * amount, 0.0, 1.0),
-                                std::clamp(color.y + (1.0 - color.y) * amount, 0.0, 1.0),
-                                std::clamp(color.z + (1.0 - color.z) * amount, 0.0, 1.0));
-}
-
-static Vec3 darken_color_by(const Vec3 &color, double amount)
-{
-        double factor = 1.0 - amount;
-        return Vec3(std::clamp(color.x * factor, 0.0, 1.0),
-                                std::clamp(color.y * factor, 0.0, 1.0),
-                                std::clamp(color.z * factor, 0.0, 1.0));
-}
-
-static Vec3 brighten_color(const Vec3 &color)
-{
-        return brighten_color_by(color, kObjectAltColorAmount);
-}
-
-static Vec3 darken_color(const Vec3 &color)
-{
-        return darken_color_by(color, kObjectAltColorAmount);
-}
-
-static int compute_checker_from_position(const Vec3 &p, double frequency)
-{
-        return (static_cast<int>(std::floor(p.x * frequency)) +
-                        static_cast<int>(std::floor(p.y * frequency)) +
-                        static_cast<int>(std::floor(p.z * frequency))) &
-               1;
-}
-
-static int compute_checker_from_uv(double u, double v, double frequency)
-{
-        return (static_cast<int>(std::floor(u * frequency)) +
-                        static_cast<int>(std::floor(v * frequency))) &
-               1;
-}
-
-static Vec3 normalize_or(const Vec3 &v, const Vec3 &fallback = Vec3(0, 0, 1))
-{
-        double len2 = v.length_squared();
-        if (len2 <= 1e-12)
-                return fallback;
-        return v / std::sqrt(len2);
-}
+static constexpr float kDynamicMaxScale = 4.0f;
+static constexpr float kDynamicScaleStep = 0.125f;
+static constexpr float kRefineFactor = 1.5f;
+static constexpr double kFrameTimingSmoothing = 0.2;
+static constexpr int kFoveaBlock = 4;
+static constexpr double kFoveaInnerRadius = 0.45;
+static constexpr double kFoveaOuterRadius = 0.9;
+static constexpr float kNoDepth = -1.0f;
+static constexpr int kMaxTraceDepth = 10;
+// Path segments weighted below one 8-bit step are dropped. Radiance can
+// exceed 1 under several lights, so this is an approximation, not exact.
+static constexpr double kMinPathWeight = 1.0 / 255.0;
+static constexpr int kWavefrontTile = 16;
+static constexpr double kReprojectDepthTolerance = 0.05;
+// Autosave once edits pause this long, and at least this often during one
+// long drag.
+static constexpr Uint32 kAutosaveQuietMs = 250;
+static constexpr Uint32 kAutosaveMaxDelayMs = 1000;
 
 static const Vec3 kDeveloperColorGrey(0.5, 0.5, 0.5);
 static const Vec3 kDeveloperColorRed(1.0, 0.0, 0.0);
@@ -174,307 +142,6 @@ static void cycle_developer_state(Hittable &obj, Material &mat)
         apply_developer_state(obj, mat, next);
 }
 
-static bool beam_parameters(const PointLight &L, const Vec3 &point, Vec3 &axis_dir,
-                           double &axial_dist, double &radial_sq)
-{
-        if (!L.beam_spotlight || L.spot_radius <= 0.0)
-                return false;
-        if (L.direction.length_squared() <= 1e-12)
-                return false;
-        axis_dir = normalize_or(L.direction);
-        Vec3 rel = point - L.position;
-        axial_dist = Vec3::dot(rel, axis_dir);
-        if (axial_dist < 0.0)
-                return false;
-        if (L.range > 0.0 && axial_dist > L.range)
-                return false;
-        Vec3 closest = L.position + axis_dir * axial_dist;
-        Vec3 radial = point - closest;
-        radial_sq = radial.length_squared();
-        double radius = L.spot_radius;
-        return radial_sq <= radius * radius;
-}
-
-static bool beam_light_through(const Scene &scene, const std::vector<Material> &mats,
-                               const Vec3 &p, const PointLight &L, const Vec3 &axis_dir,
-                               double axis_dist, Vec3 &color, double &intensity)
-{
-        if (axis_dist <= 1e-6)
-        {
-                color = L.color;
-                intensity = L.intensity;
-                return true;
-        }
-        color = L.color;
-        intensity = L.intensity;
-        Vec3 dir = axis_dir * -1.0;
-        Ray shadow_ray(p + dir * 1e-4, dir);
-        double max_dist = axis_dist - 1e-4;
-        while (max_dist > 1e-4)
-        {
-                HitRecord tmp;
-                bool hit_any = false;
-                double closest = max_dist;
-                int hit_mat = -1;
-                for (const auto &obj : scene.objects)
-                {
-                        if (!obj->casts_shadow())
-                                continue;
-                        if (obj->is_beam())
-                                continue;
-                        if (std::find(L.ignore_ids.begin(), L.ignore_ids.end(),
-                                                  obj->object_id) != L.ignore_ids.end())
-                                continue;
-                        if (obj->hit(shadow_ray, 1e-4, closest, tmp))
-                        {
-                                closest = tmp.t;
-                                hit_mat = tmp.material_id;
-                                hit_any = true;
-                        }
-                }
-                if (!hit_any)
-                        break;
-                const Material &m = mats[hit_mat];
-                if (m.alpha >= 1.0)
-                        return false;
-                color = mix_colors(color, m.base_color, m.alpha);
-                intensity *= (1.0 - m.alpha);
-                shadow_ray.orig = shadow_ray.orig + shadow_ray.dir * (closest + 1e-4);
-                max_dist -= closest + 1e-4;
-                if (intensity <= 1e-4)
-                        return false;
-        }
-        return true;
-}
-
-static bool light_through(const Scene &scene, const std::vector<Material> &mats,
-                                                const Vec3 &p, const PointLight &L,
-                                                Vec3 &color, double &intensity)
-{
-        Vec3 to_light = L.position - p;
-        double dist_to_light = to_light.length();
-        if (L.range > 0.0 && dist_to_light > L.range)
-                return false;
-        Vec3 dir = to_light.normalized();
-        Ray shadow_ray(p + dir * 1e-4, dir);
-        double max_dist = dist_to_light - 1e-4;
-        color = L.color;
-        intensity = L.intensity;
-        while (max_dist > 1e-4)
-        {
-                HitRecord tmp;
-                bool hit_any = false;
-                double closest = max_dist;
-                int hit_mat = -1;
-                for (const auto &obj : scene.objects)
-                {
-                        if (!obj->casts_shadow())
-                                continue;
-                        if (obj->is_beam())
-                                continue;
-                        if (std::find(L.ignore_ids.begin(), L.ignore_ids.end(),
-                                                  obj->object_id) != L.ignore_ids.end())
-                                continue;
-                        if (obj->hit(shadow_ray, 1e-4, closest, tmp))
-                        {
-                                closest = tmp.t;
-                                hit_mat = tmp.material_id;
-                                hit_any = true;
-                        }
-                }
-                if (!hit_any)
-                        break;
-                const Material &m = mats[hit_mat];
-                if (m.alpha >= 1.0)
-                        return false;
-                color = mix_colors(color, m.base_color, m.alpha);
-                intensity *= (1.0 - m.alpha);
-                shadow_ray.orig = shadow_ray.orig + shadow_ray.dir * (closest + 1e-4);
-                max_dist -= closest + 1e-4;
-                if (intensity <= 1e-4)
-                        return false;
-        }
-        return true;
-}
-
-namespace
-{
-
-struct Basis
-{
-        Vec3 u;
-        Vec3 v;
-        Vec3 w;
-};
-
-Basis make_basis(const Vec3 &axis)
-{
-        Basis b{};
-        double len2 = axis.length_squared();
-        if (len2 <= 1e-12)
-        {
-                b.w = Vec3(0, 0, 1);
-                b.u = Vec3(1, 0, 0);
-                b.v = Vec3(0, 1, 0);
-                return b;
-        }
-        b.w = axis / std::sqrt(len2);
-        Vec3 helper = (std::abs(b.w.z) < 0.999) ? Vec3(0, 0, 1) : Vec3(0, 1, 0);
-        b.u = Vec3::cross(helper, b.w);
-        double ulen = b.u.length();
-        if (ulen <= 1e-12)
-        {
-                helper = Vec3(0, 1, 0);
-                b.u = Vec3::cross(helper, b.w);
-                ulen = b.u.length();
-        }
-        b.u = (ulen > 1e-12) ? b.u / ulen : Vec3(1, 0, 0);
-        b.v = Vec3::cross(b.w, b.u);
-        return b;
-}
-
-bool light_ignores(const PointLight &L, int object_id)
-{
-        return std::find(L.ignore_ids.begin(), L.ignore_ids.end(), object_id) !=
-               L.ignore_ids.end();
-}
-
-Vec3 clamp_color(const Vec3 &c, double lo = 0.0, double hi = 1.0)
-{
-        return Vec3(std::clamp(c.x, lo, hi), std::clamp(c.y, lo, hi),
-                                std::clamp(c.z, lo, hi));
-}
-
-Vec3 surface_color_at(const Scene &scene, const HitRecord &rec,
-                                         const Material &mat,
-                                         bool use_base_state = false)
-{
-        Vec3 base = mat.base_color;
-        Vec3 col = use_base_state ? mat.base_color : mat.color;
-        bool is_plane = false;
-        if (rec.object_id >= 0 &&
-                rec.object_id < static_cast<int>(scene.objects.size()))
-        {
-                auto obj = scene.objects[rec.object_id];
-                if (obj->is_beam())
-                {
-                        auto beam = std::static_pointer_cast<Laser>(obj);
-                        base = col = beam->color;
-                }
-                else if (obj->is_plane())
-                {
-                        is_plane = true;
-                }
-        }
-        if (is_plane)
-        {
-                Vec3 brighter = brighten_color_by(base, kPlaneAltColorAmount);
-                Vec3 darker = darken_color_by(base, kPlaneAltColorAmount);
-                double u = rec.has_uv ? rec.u : rec.p.x;
-                double v = rec.has_uv ? rec.v : rec.p.y;
-                int chk = compute_checker_from_uv(u, v, kPlaneCheckerFrequency);
-                col = chk ? brighter : darker;
-        }
-        else if (!use_base_state && mat.checkered)
-        {
-                Vec3 brighter = brighten_color(base);
-                Vec3 darker = darken_color(base);
-                int chk = compute_checker_from_position(rec.p, kObjectCheckerFrequency);
-                col = chk ? brighter : darker;
-        }
-        return col;
-}
-
-double compute_effective_alpha(const Material &mat, const HitRecord &rec)
-{
-        double alpha = mat.alpha;
-        if (mat.random_alpha)
-        {
-                double tpos = std::clamp(rec.beam_ratio, 0.0, 1.0);
-                alpha *= (1.0 - tpos);
-        }
-        return std::clamp(alpha, 0.0, 1.0);
-}
-
-Vec3 ambient_contribution(const Scene &scene, const Vec3 &surface_color)
-{
-        return Vec3(surface_color.x * scene.ambient.color.x * scene.ambient.intensity,
-                                surface_color.y * scene.ambient.color.y * scene.ambient.intensity,
-                                surface_color.z * scene.ambient.color.z * scene.ambient.intensity);
-}
-
-Vec3 light_contribution(const Scene &scene, const std::vector<Material> &mats,
-                                         const PointLight &light, const HitRecord &rec,
-                                         const Vec3 &surface_color, const Material &mat,
-                                         const Vec3 &point, const Vec3 &view_dir)
-{
-        if (light_ignores(light, rec.object_id))
-                return Vec3(0.0, 0.0, 0.0);
-        Vec3 lcolor;
-        double lintensity;
-        Vec3 ldir;
-        double atten = 1.0;
-        if (light.beam_spotlight && light.spot_radius > 0.0)
-        {
-                Vec3 axis_dir;
-                double axial_dist;
-                double radial_sq;
-                if (!beam_parameters(light, point, axis_dir, axial_dist, radial_sq))
-                        return Vec3(0.0, 0.0, 0.0);
-                if (!beam_light_through(scene, mats, point, light, axis_dir, axial_dist,
-                                        lcolor, lintensity))
-                        return Vec3(0.0, 0.0, 0.0);
-                if (light.range > 0.0)
-                {
-                        atten = std::max(0.0, 1.0 - axial_dist / light.range);
-                        if (atten <= 0.0)
-                                return Vec3(0.0, 0.0, 0.0);
-                }
-                ldir = axis_dir * -1.0;
-        }
-        else
-        {
-                Vec3 to_light = light.position - point;
-                double dist = to_light.length();
-                if (dist <= 1e-6)
-                        return Vec3(0.0, 0.0, 0.0);
-                ldir = to_light / dist;
-                if (light.cutoff_cos > -1.0)
-                {
-                        Vec3 spot_dir = (point - light.position).normalized();
-                        if (Vec3::dot(light.direction, spot_dir) < light.cutoff_cos)
-                                return Vec3(0.0, 0.0, 0.0);
-                }
-                if (!light_through(scene, mats, point, light, lcolor, lintensity))
-                        return Vec3(0.0, 0.0, 0.0);
-                if (light.range > 0.0)
-                {
-                        atten = std::max(0.0, 1.0 - dist / light.range);
-                        if (atten <= 0.0)
-                                return Vec3(0.0, 0.0, 0.0);
-                }
-        }
-        double diff = std::max(0.0, Vec3::dot(rec.normal, ldir));
-        if (diff <= 1e-6)
-                return Vec3(0.0, 0.0, 0.0);
-        Vec3 h = (ldir + view_dir).normalized();
-        double spec = 0.0;
-        if (mat.specular_k > 0.0)
-        {
-                spec = std::pow(std::max(0.0, Vec3::dot(rec.normal, h)), mat.specular_exp) *
-                       mat.specular_k;
-        }
-        double diff_term = lintensity * diff * atten;
-        return Vec3(surface_color.x * lcolor.x * diff_term + lcolor.x * spec * atten,
-                                surface_color.y * lcolor.y * diff_term + lcolor.y * spec * atten,
-                                surface_color.z * lcolor.z * diff_term + lcolor.z * spec * atten);
-}
-
-double luminance(const Vec3 &c)
-{
-        return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
-}
-
 static Vec3 highlight_alternate_color(const Vec3 &base)
 {
         double lum = luminance(base);
@@ -482,209 +149,6 @@ static Vec3 highlight_alternate_color(const Vec3 &base)
         return use_brighter ? brighten_color(base) : darken_color(base);
 }
 
-double trace_spotlight_sample(const Scene &scene, const std::vector<Material> &mats,
-                                                         const PointLight &L, const Vec3 &axis_dir,
-                                                         const Vec3 &sample_origin,
-                                                         double sample_area, int limit_object = -1)
-{
-        if (L.intensity <= 1e-4)
-                return 0.0;
-        Vec3 dir = normalize_or(axis_dir);
-        const double max_range = (L.range > 0.0) ? L.range : 1e9;
-        double travelled = 0.0;
-        Vec3 origin = sample_origin;
-        double transmittance = 1.0;
-        double total_area = 0.0;
-
-        while (travelled < max_range - 1e-4 && transmittance > 1e-4)
-        {
-                Ray ray(origin, dir);
-                double closest = max_range - travelled;
-                HitRecord rec;
-                bool hit_any = false;
-                Hittable *hit_obj = nullptr;
-                for (const auto &obj : scene.objects)
-                {
-                        if (obj->is_beam())
-                                continue;
-                        if (light_ignores(L, obj->object_id))
-                                continue;
-                        HitRecord tmp;
-                        if (obj->hit(ray, 1e-4, closest, tmp))
-                        {
-                                closest = tmp.t;
-                                rec = tmp;
-                                hit_any = true;
-                                hit_obj = obj.get();
-                        }
-                }
-                if (!hit_any)
-                        break;
-
-                travelled += closest;
-                Vec3 point = ray.at(closest);
-
-                if (hit_obj && hit_obj->scorable && !hit_obj->is_beam() &&
-                    (limit_object < 0 || hit_obj->object_id == limit_object))
-                {
-                        Vec3 ldir = dir * -1.0;
-                        double cos_incident =
-                                std::max(0.0, Vec3::dot(rec.normal, ldir));
-                        if (cos_incident > 1e-6)
-                        {
-                                const Material &mat = mats[rec.material_id];
-                                Vec3 surface_color =
-                                        surface_color_at(scene, rec, mat, true);
-                                Vec3 view_dir = rec.normal.normalized();
-                                Vec3 base = ambient_contribution(scene, surface_color);
-                                for (const auto &other : scene.lights)
-                                {
-                                        if (&other == &L)
-                                                continue;
-                                        base += light_contribution(scene, mats, other, rec,
-                                                                   surface_color, mat, point,
-                                                                   view_dir);
-                                }
-                                Vec3 beam_contrib = light_contribution(
-                                        scene, mats, L, rec, surface_color, mat, point,
-                                        view_dir);
-                                if (beam_contrib.length_squared() > 1e-12)
-                                {
-                                        Vec3 base_clamped = clamp_color(base);
-                                        Vec3 with_clamped =
-                                                clamp_color(base + beam_contrib);
-                                        Vec3 delta = with_clamped - base_clamped;
-                                        delta.x = std::max(0.0, delta.x);
-                                        delta.y = std::max(0.0, delta.y);
-                                        delta.z = std::max(0.0, delta.z);
-                                        double delta_luma = luminance(delta);
-                                        if (delta_luma > 1e-6)
-                                        {
-                                                double area = sample_area / cos_incident;
-                                                double alpha = compute_effective_alpha(mat, rec);
-                                                total_area += area * delta_luma * alpha;
-                                        }
-                                }
-                        }
-                }
-
-                const Material &mat = mats[rec.material_id];
-                double effective_alpha = compute_effective_alpha(mat, rec);
-                if (effective_alpha >= 1.0)
-                        break;
-
-                transmittance *= (1.0 - effective_alpha);
-                if (transmittance <= 1e-4)
-                        break;
-
-                travelled += 1e-4;
-                origin = point + dir * 1e-4;
-        }
-
-        return total_area;
-}
-
-double integrate_spotlight_area(const Scene &scene, const std::vector<Material> &mats,
-                                                           const PointLight &L)
-{
-        if (!L.beam_spotlight || L.intensity <= 0.0)
-                return 0.0;
-        if (L.spot_radius <= 0.0)
-                return 0.0;
-        Basis basis = make_basis(L.direction);
-        Vec3 axis_dir = basis.w;
-        const int grid = 16;
-        double disk_area = M_PI * L.spot_radius * L.spot_radius;
-        if (disk_area <= 1e-12)
-                return 0.0;
-        double sample_area = disk_area / (grid * grid);
-
-        double total = 0.0;
-        for (int iy = 0; iy < grid; ++iy)
-        {
-                for (int ix = 0; ix < grid; ++ix)
-                {
-                        double su = (ix + 0.5) / static_cast<double>(grid);
-                        double sv = (iy + 0.5) / static_cast<double>(grid);
-                        double radius = L.spot_radius * std::sqrt(su);
-                        double phi = 2.0 * M_PI * sv;
-                        Vec3 offset = basis.u * (std::cos(phi) * radius) +
-                                      basis.v * (std::sin(phi) * radius);
-                        Vec3 sample_origin = L.position + offset + axis_dir * 1e-4;
-                        total += trace_spotlight_sample(scene, mats, L, axis_dir,
-                                                        sample_origin, sample_area);
-                }
-        }
-        return total;
-}
-
-double compute_beam_score(const Scene &scene, const std::vector<Material> &mats)
-{
-        double score = 0.0;
-        for (const auto &L : scene.lights)
-        {
-                if (!L.beam_spotlight)
-                        continue;
-                score += integrate_spotlight_area(scene, mats, L);
-        }
-        return score;
-}
-
-double integrate_spotlight_area_for_object(const Scene &scene,
-                                          const std::vector<Material> &mats,
-                                          const PointLight &L, int object_id)
-{
-        if (object_id < 0)
-                return 0.0;
-        if (!L.beam_spotlight || L.intensity <= 0.0)
-                return 0.0;
-        if (L.spot_radius <= 0.0)
-                return 0.0;
-        Basis basis = make_basis(L.direction);
-        Vec3 axis_dir = basis.w;
-        const int grid = 16;
-        double disk_area = M_PI * L.spot_radius * L.spot_radius;
-        if (disk_area <= 1e-12)
-                return 0.0;
-        double sample_area = disk_area / (grid * grid);
-
-        double total = 0.0;
-        for (int iy = 0; iy < grid; ++iy)
-        {
-                for (int ix = 0; ix < grid; ++ix)
-                {
-                        double su = (ix + 0.5) / static_cast<double>(grid);
-                        double sv = (iy + 0.5) / static_cast<double>(grid);
-                        double radius = L.spot_radius * std::sqrt(su);
-                        double phi = 2.0 * M_PI * sv;
-                        Vec3 offset = basis.u * (std::cos(phi) * radius) +
-                                      basis.v * (std::sin(phi) * radius);
-                        Vec3 sample_origin = L.position + offset + axis_dir * 1e-4;
-                        total += trace_spotlight_sample(scene, mats, L, axis_dir,
-                                                        sample_origin, sample_area,
-                                                        object_id);
-                }
-        }
-        return total;
-}
-
-double compute_object_beam_score(const Scene &scene,
-                                const std::vector<Material> &mats, int object_id)
-{
-        if (object_id < 0)
-                return 0.0;
-        double score = 0.0;
-        for (const auto &L : scene.lights)
-        {
-                if (!L.beam_spotlight)
-                        continue;
-                score += integrate_spotlight_area_for_object(scene, mats, L, object_id);
-        }
-        return score;
-}
-
-} // namespace
-
 namespace
 {
 
@@ -908,45 +372,404 @@ bool target_blinking(const Scene &scene)
 
 } // namespace
 
-static Vec3 trace_ray(const Scene &scene, const std::vector<Material> &mats,
-                                          const Ray &r, std::mt19937 &rng,
-                                          std::uniform_real_distribution<double> &dist,
-                                          int depth = 0)
+// A pending piece of a camera path: the ray to follow and the weight its
+// colour carries into the pixel.
+struct PathSegment
 {
-        if (depth > 10)
-                return Vec3(0.0, 0.0, 0.0);
-	HitRecord rec;
-	if (!scene.hit(r, 1e-4, 1e9, rec))
-	{
-		return Vec3(0.0, 0.0, 0.0);
-	}
+        Ray ray;
+        double weight;
+        int depth;
+};
+
+/// Shade the hit `rec` of `seg` and pass its transparency and mirror
+/// continuations to `emit`. Shading and continuations weighted below
+/// kMinPathWeight are skipped; they rarely move the 8-bit output by more
+/// than a step, though a bright enough surface can. The depth limit
+/// matches the old recursion.
+template <typename Emit>
+static Vec3 shade_segment(const Scene &scene, const std::vector<Material> &mats,
+                          const LightGrid &light_grid, const PathSegment &seg,
+                          const HitRecord &rec, Emit &&emit)
+{
+        Vec3 color(0.0, 0.0, 0.0);
         const Material &m = mats[rec.material_id];
-        Vec3 eye = (r.dir * -1.0).normalized();
-        Vec3 surface_color = surface_color_at(scene, rec, m);
-        Vec3 sum = ambient_contribution(scene, surface_color);
-        for (const auto &L : scene.lights)
+        double alpha = compute_effective_alpha(m, rec);
+        double refl_ratio = m.mirror ? REFLECTION / 100.0 : 0.0;
+        double local_weight = seg.weight * alpha * (1.0 - refl_ratio);
+        if (local_weight >= kMinPathWeight)
         {
-                sum += light_contribution(scene, mats, L, rec, surface_color, m, rec.p, eye);
+                Vec3 eye = (seg.ray.dir * -1.0).normalized();
+                Vec3 surface_color = surface_color_at(scene, rec, m);
+                Vec3 sum = ambient_contribution(scene, surface_color);
+                for (int li : light_grid.lights_at(rec.p))
+                        sum += light_contribution(scene, mats, light_grid.light(li), rec,
+                                                  surface_color, m, rec.p, eye);
+                color = sum * local_weight;
         }
-        if (m.mirror)
-	{
-		Vec3 refl_dir =
-			r.dir - rec.normal * (2.0 * Vec3::dot(r.dir, rec.normal));
-		Ray refl(rec.p + refl_dir * 1e-4, refl_dir);
-                Vec3 refl_col = trace_ray(scene, mats, refl, rng, dist, depth + 1);
-                double refl_ratio = REFLECTION / 100.0;
-                sum = sum * (1.0 - refl_ratio) + refl_col * refl_ratio;
+        if (seg.depth >= kMaxTraceDepth)
+                return color;
+        double behind_weight = seg.weight * (1.0 - alpha);
+        if (behind_weight >= kMinPathWeight)
+        {
+                Ray next(rec.p + seg.ray.dir * 1e-4, seg.ray.dir);
+                ray_stats::count_ray(RayKind::Transparency);
+                emit(PathSegment{next, behind_weight, seg.depth + 1});
         }
-        double alpha = compute_effective_alpha(m, rec);
-        if (alpha < 1.0)
+        double refl_weight = seg.weight * alpha * refl_ratio;
+        if (refl_weight >= kMinPathWeight)
         {
-                Ray next(rec.p + r.dir * 1e-4, r.dir);
-                Vec3 behind = trace_ray(scene, mats, next, rng, dist, depth + 1);
-                return sum * alpha + behind * (1.0 - alpha);
+                Vec3 refl_dir =
+                        seg.ray.dir - rec.normal * (2.0 * Vec3::dot(seg.ray.dir, rec.normal));
+                Ray refl(rec.p + refl_dir * 1e-4, refl_dir);
+                ray_stats::count_ray(RayKind::Mirror);
+                emit(PathSegment{refl, refl_weight, seg.depth + 1});
         }
-        return sum;
+        return color;
 }
 
+/// Trace a primary ray through mirrors and transparent surfaces. Instead of
+/// recursing, pending segments wait on a small stack, each carrying the
+/// weight it contributes to the pixel.
+static Vec3 trace_ray(const Scene &scene, const std::vector<Material> &mats,
+                      const LightGrid &light_grid, const Ray &r, int depth = 0,
+                      double *hit_t = nullptr)
+{
+        // Depth-first order keeps at most one pending sibling per level.
+        PathSegment stack[2 * (kMaxTraceDepth + 2)];
+        int top = 0;
+        stack[top++] = PathSegment{r, 1.0, depth};
+        if (depth == 0)
+                ray_stats::count_ray(RayKind::Primary);
+        auto push = [&](const PathSegment &child) { stack[top++] = child; };
+        Vec3 color(0.0, 0.0, 0.0);
+        bool primary = true;
+        while (top > 0)
+        {
+                PathSegment seg = stack[--top];
+                HitRecord rec;
+                bool hit = scene.hit(seg.ray, 1e-4, 1e9, rec);
+                if (primary)
+                {
+                        if (hit_t)
+                                *hit_t = hit ? rec.t : -1.0;
+                        primary = false;
+                }
+                if (hit)
+                        color += shade_segment(scene, mats, light_grid, seg, rec, push);
+        }
+        return color;
+}
+
+// Wavefront tracing: a tile is traced one bounce level at a time. Each
+// level's rays sit in a compact batch that is traced through the BVH in
+// one traversal; hits are sorted so equal materials and light cells are
+// shaded back to back, and only live continuations are gathered into the
+// next level's batch.
+struct WavefrontScratch
+{
+        RayBatch batch;
+        std::vector<double> weights;
+        std::vector<int> pixels;
+        std::vector<Ray> next_rays;
+        std::vector<double> next_weights;
+        std::vector<int> next_pixels;
+        std::vector<unsigned long long> order;
+};
+
+/// Trace the pixels of [x0, x1) x [y0, y1) accepted by `traced` into
+/// `framebuffer`, writing primary hit distances to `depth` when given.
+/// Returns the number of camera and bounce rays traced.
+template <typename Traced>
+static long long trace_tile_wavefront(const Scene &scene, const std::vector<Material> &mats,
+                                 const LightGrid &light_grid, const PixelGrid &grid, int x0,
+                                 int y0, int x1, int y1, int RW, Traced &&traced,
+                                 std::vector<ColorF> &framebuffer, float *depth,
+                                 WavefrontScratch &ws)
+{
+        ws.batch.rays.clear();
+        ws.weights.clear();
+        ws.pixels.clear();
+        for (int y = y0; y < y1; ++y)
+        {
+                Vec3 dir = grid.direction(x0, y);
+                for (int x = x0; x < x1; ++x, dir += grid.dx)
+                {
+                        if (!traced(x, y))
+                                continue;
+                        int pixel = y * RW + x;
+                        framebuffer[pixel] = ColorF();
+                        if (depth)
+                                depth[pixel] = kNoDepth;
+                        ws.batch.rays.push_back(Ray(grid.origin, dir.normalized()));
+                        ws.weights.push_back(1.0);
+                        ws.pixels.push_back(pixel);
+                }
+        }
+        // Primary rays share the camera origin, so the BVH can reject
+        // whole nodes for the tile before looking at single rays.
+        const Frustum frustum = grid.tile_frustum(x0, y0, x1, y1);
+        ray_stats::count_ray(RayKind::Primary, ws.batch.rays.size());
+        long long rays = 0;
+        for (int level = 0; !ws.batch.rays.empty(); ++level)
+        {
+                ws.batch.frustum = level == 0 ? &frustum : nullptr;
+                scene.hit_batch(ws.batch, 1e-4, 1e9);
+                rays += static_cast<long long>(ws.batch.rays.size());
+                // Sort key: material, then light cell, then ray index.
+                ws.order.clear();
+                for (size_t i = 0; i < ws.batch.rays.size(); ++i)
+                {
+                        if (!ws.batch.hit[i])
+                                continue;
+                        const HitRecord &rec = ws.batch.recs[i];
+                        if (level == 0 && depth)
+                                depth[ws.pixels[i]] = static_cast<float>(rec.t);
+                        unsigned long long cell =
+                                static_cast<unsigned long long>(light_grid.cell_of(rec.p) + 1);
+                        ws.order.push_back(
+                                (static_cast<unsigned long long>(rec.material_id) << 40) |
+                                (cell << 20) | i);
+                }
+                std::sort(ws.order.begin(), ws.order.end());
+                ws.next_rays.clear();
+                ws.next_weights.clear();
+                ws.next_pixels.clear();
+                for (unsigned long long key : ws.order)
+                {
+                        size_t i = key & 0xFFFFF;
+                        int pixel = ws.pixels[i];
+                        auto gather = [&](const PathSegment &child)
+                        {
+                                ws.next_rays.push_back(child.ray);
+                                ws.next_weights.push_back(child.weight);
+                                ws.next_pixels.push_back(pixel);
+                        };
+                        PathSegment seg{ws.batch.rays[i], ws.weights[i], level};
+                        framebuffer[pixel] += shade_segment(scene, mats, light_grid, seg,
+                                                            ws.batch.recs[i], gather);
+                }
+                std::swap(ws.batch.rays, ws.next_rays);
+                std::swap(ws.weights, ws.next_weights);
+                std::swap(ws.pixels, ws.next_pixels);
+        }
+        return rays;
+}
+
+namespace
+{
+
+// Frame-time controller for dynamic resolution. The trace cost is tracked
+// per pixel and the rest of the frame as a fixed overhead, so the coarse
+// scale can be predicted no matter which resolution was rendered last.
+struct DynamicResolution
+{
+        double target_ms = 0.0;
+        double pixel_cost_ms = 0.0;
+        double overhead_ms = 0.0;
+        bool primed = false;
+        float coarse_scale = 2.0f;
+        float scale = 2.0f;
+};
+
+void record_frame_timing(DynamicResolution &dr, double trace_ms, double frame_ms,
+                         int traced_pixels)
+{
+        if (traced_pixels <= 0 || trace_ms <= 0.0)
+                return;
+        double cost = trace_ms / traced_pixels;
+        double overhead = std::max(0.0, frame_ms - trace_ms);
+        if (!dr.primed)
+        {
+                dr.pixel_cost_ms = cost;
+                dr.overhead_ms = overhead;
+                dr.primed = true;
+                return;
+        }
+        dr.pixel_cost_ms += (cost - dr.pixel_cost_ms) * kFrameTimingSmoothing;
+        dr.overhead_ms += (overhead - dr.overhead_ms) * kFrameTimingSmoothing;
+}
+
+/// Pick the downscale factor for the next frame. Moving views jump to the
+/// coarse scale that fits the frame budget; static views refine towards
+/// full resolution a step per frame.
+float choose_dynamic_scale(DynamicResolution &dr, int W, int H, bool view_changed)
+{
+        if (dr.primed && dr.target_ms > 0.0 && dr.pixel_cost_ms > 0.0)
+        {
+                // Always leave a quarter of the frame for tracing so a slow
+                // HUD or autosave cannot push the scale to the limit.
+                double budget = std::max(dr.target_ms * 0.25, dr.target_ms - dr.overhead_ms);
+                double affordable = budget / dr.pixel_cost_ms;
+                double wanted = std::sqrt(static_cast<double>(W) * H / affordable);
+                wanted = std::ceil(wanted / kDynamicScaleStep) * kDynamicScaleStep;
+                dr.coarse_scale = static_cast<float>(
+                        std::clamp(wanted, 1.0, static_cast<double>(kDynamicMaxScale)));
+        }
+        if (view_changed)
+                dr.scale = dr.coarse_scale;
+        else
+                dr.scale = std::max(1.0f, dr.scale / kRefineFactor);
+        return dr.scale;
+}
+
+// Sample density layout for foveated frames. The image is split into
+// kFoveaBlock-sized blocks; blocks near the crosshair trace every pixel,
+// the middle ring every second pixel and the periphery every fourth, with
+// radii measured in half screen heights.
+struct FoveationPattern
+{
+        bool enabled = false;
+        int width = 0;
+        int height = 0;
+
+        int stride_at(int x, int y) const
+        {
+                if (!enabled)
+                        return 1;
+                double bx = (x / kFoveaBlock) * kFoveaBlock + kFoveaBlock * 0.5 - width * 0.5;
+                double by = (y / kFoveaBlock) * kFoveaBlock + kFoveaBlock * 0.5 - height * 0.5;
+                double half = 0.5 * std::min(width, height);
+                double r2 = (bx * bx + by * by) / (half * half);
+                if (r2 < kFoveaInnerRadius * kFoveaInnerRadius)
+                        return 1;
+                if (r2 < kFoveaOuterRadius * kFoveaOuterRadius)
+                        return 2;
+                return 4;
+        }
+
+        bool traced(int x, int y) const
+        {
+                int stride = stride_at(x, y);
+                return (x % stride) == 0 && (y % stride) == 0;
+        }
+};
+
+/// Fill one pixel that was skipped by the foveation pattern with a bilinear
+/// blend of the traced lattice corners around it. Corners that fall into a
+/// sparser neighbouring block are skipped and the weights renormalised.
+Vec3 reconstruct_foveated(const std::vector<ColorF> &framebuffer,
+                          const FoveationPattern &pattern, int x, int y)
+{
+        int stride = pattern.stride_at(x, y);
+        int x0 = x - x % stride;
+        int y0 = y - y % stride;
+        double fx = static_cast<double>(x - x0) / stride;
+        double fy = static_cast<double>(y - y0) / stride;
+        const int xs[2] = {x0, x0 + stride};
+        const int ys[2] = {y0, y0 + stride};
+        const double wx[2] = {1.0 - fx, fx};
+        const double wy[2] = {1.0 - fy, fy};
+        Vec3 sum(0.0, 0.0, 0.0);
+        double weight = 0.0;
+        for (int j = 0; j < 2; ++j)
+        {
+                for (int i = 0; i < 2; ++i)
+                {
+                        double w = wx[i] * wy[j];
+                        if (w <= 0.0 || xs[i] >= pattern.width || ys[j] >= pattern.height)
+                                continue;
+                        if (!pattern.traced(xs[i], ys[j]))
+                                continue;
+                        sum += framebuffer[ys[j] * pattern.width + xs[i]].vec() * w;
+                        weight += w;
+                }
+        }
+        if (weight <= 0.0)
+                return framebuffer[y0 * pattern.width + x0].vec();
+        return sum / weight;
+}
+
+bool checker_traced(int x, int y, int parity)
+{
+        return ((x + y + parity) & 1) == 0;
+}
+
+bool project_to_pixel(const Camera &c, const Vec3 &p, int RW, int RH, int &px, int &py)
+{
+        Vec3 rel = p - c.origin;
+        double z = Vec3::dot(rel, c.forward);
+        if (z <= 1e-6)
+                return false;
+        double fov_rad = c.fov_deg * M_PI / 180.0;
+        double half_h = std::tan(fov_rad * 0.5);
+        double half_w = c.aspect * half_h;
+        double u = (Vec3::dot(rel, c.right) / z / half_w + 1.0) * 0.5;
+        double v = (1.0 - Vec3::dot(rel, c.up) / z / half_h) * 0.5;
+        px = static_cast<int>(std::floor(u * RW));
+        py = static_cast<int>(std::floor(v * RH));
+        return px >= 0 && px < RW && py >= 0 && py < RH;
+}
+
+/// Fill one pixel skipped by the checkerboard pattern. Candidate depths (the
+/// last frame's depth at this pixel, then the four traced neighbours) are
+/// reprojected into the previous camera; the first one that lands on a
+/// surface the last frame saw at the same distance supplies its colour.
+/// Without a match the traced neighbours are averaged.
+Vec3 reconstruct_checker(const Camera &cam, const Camera *prev_cam,
+                         const std::vector<ColorF> &framebuffer,
+                         const std::vector<float> &depth,
+                         const std::vector<ColorF> &prev_color,
+                         const std::vector<float> &prev_depth, int RW, int RH, int x,
+                         int y, float &out_depth)
+{
+        static const int kOffsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        Vec3 sum(0.0, 0.0, 0.0);
+        int count = 0;
+        float candidates[5];
+        int candidate_count = 0;
+        float near_depth = 0.0f;
+        float far_depth = 0.0f;
+        bool has_surface = false;
+        if (prev_cam)
+                candidates[candidate_count++] = prev_depth[y * RW + x];
+        for (const auto &off : kOffsets)
+        {
+                int nx = x + off[0];
+                int ny = y + off[1];
+                if (nx < 0 || nx >= RW || ny < 0 || ny >= RH)
+                        continue;
+                sum += framebuffer[ny * RW + nx].vec();
+                ++count;
+                float d = depth[ny * RW + nx];
+                candidates[candidate_count++] = d;
+                if (d < 0.0f)
+                        continue;
+                near_depth = has_surface ? std::min(near_depth, d) : d;
+                far_depth = has_surface ? std::max(far_depth, d) : d;
+                has_surface = true;
+        }
+        out_depth = has_surface ? near_depth : kNoDepth;
+        Vec3 average = count > 0 ? sum / count : Vec3(0.0, 0.0, 0.0);
+        if (!prev_cam || !has_surface)
+                return average;
+
+        Ray r = cam.ray_through((x + 0.5) / RW, (y + 0.5) / RH);
+        for (int i = 0; i < candidate_count; ++i)
+        {
+                double d = candidates[i];
+                // Only depths bracketed by the current neighbours describe the
+                // surface this pixel is looking at now.
+                if (d < near_depth * (1.0 - kReprojectDepthTolerance) ||
+                    d > far_depth * (1.0 + kReprojectDepthTolerance))
+                        continue;
+                Vec3 p = r.at(d);
+                int px, py;
+                if (!project_to_pixel(*prev_cam, p, RW, RH, px, py))
+                        continue;
+                double seen = prev_depth[py * RW + px];
+                if (seen < 0.0)
+                        continue;
+                double expected = (p - prev_cam->origin).length();
+                if (std::fabs(seen - expected) > kReprojectDepthTolerance * expected)
+                        continue;
+                out_depth = static_cast<float>(d);
+                return prev_color[py * RW + px].vec();
+        }
+        return average;
+}
+
+} // namespace
+
 Renderer::Renderer(Scene &s, Camera &c) : scene(s), cam(c) {}
 
 struct Renderer::RenderState
@@ -965,8 +788,23 @@ struct Renderer::RenderState
         Vec3 edit_pos;
         int spawn_key = -1;
         double fps = 0.0;
+        double last_trace_ms = 0.0;
+        RayCounters ray_stats; // last finished frame, with MINIRT_RAY_STATS
+        LightGrid light_grid;
+        // Checkerboard history: last frame's colours and primary hit
+        // distances, plus the camera and geometry they were traced with.
+        std::vector<ColorF> history_color;
+        std::vector<float> history_depth;
+        std::vector<float> depth;
+        std::optional<Camera> history_cam;
+        unsigned long history_geometry = 0;
+        int history_w = 0;
+        int history_h = 0;
+        int checker_parity = 0;
         bool scene_dirty = false;
-        Uint32 last_auto_save = 0;
+        Uint32 dirty_since = 0; // first edit not handed to the autosaver
+        Uint32 last_edit = 0;
+        AutoSaver autosaver;
         double last_score = 0.0;
         int level_number = 0;
         std::string level_label;
@@ -986,6 +824,8 @@ struct Renderer::RenderState
         Uint32 tutorial_prompt_shown_at = 0;
 };
 
+Renderer::~Renderer() = default;
+
 namespace
 {
 
@@ -1007,7 +847,22 @@ std::optional<int> next_level_index(const Renderer::RenderState &st)
 
 void Renderer::mark_scene_dirty(RenderState &st)
 {
+        Uint32 now = SDL_GetTicks();
+        if (!st.scene_dirty)
+                st.dirty_since = now;
         st.scene_dirty = true;
+        st.last_edit = now;
+}
+
+/// Rebuild beams and the BVH after the scene changed.
+void Renderer::refresh_scene(std::vector<Material> &mats)
+{
+        {
+                ProfileScope scope(ProfileStage::Beams);
+                scene.update_beams(mats);
+        }
+        ProfileScope scope(ProfileStage::Bvh);
+        scene.build_bvh();
 }
 
 /// Initialize SDL window, renderer and texture objects.
@@ -1036,7 +891,7 @@ bool Renderer::init_sdl(SDL_Window *&win, SDL_Renderer *&ren, SDL_Texture *&tex,
                 SDL_Quit();
                 return false;
         }
-        tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGB24,
+        tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA32,
                                                          SDL_TEXTUREACCESS_STREAMING, RW, RH);
         if (!tex)
         {
@@ -1077,8 +932,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                 if (Parser::parse_rt_file(next_path.string(), scene, cam, W, H))
                 {
                         mats = Parser::get_materials();
-                        scene.update_beams(mats);
-                        scene.build_bvh();
+                        refresh_scene(mats);
                         st.tutorial_prompts = scene.prompts;
                         st.tutorial_prompt_index = 0;
                         st.tutorial_prompt_shown_at = SDL_GetTicks();
@@ -1088,7 +942,6 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                         st.level_number = parse_level_number_from_path(st.scene_path);
                         st.level_label = level_label_from_path(st.scene_path);
                         st.scene_dirty = false;
-                        st.last_auto_save = SDL_GetTicks();
                         st.edit_mode = false;
                         st.align_on_grab = false;
                         st.rotating = false;
@@ -1107,8 +960,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                 scene = std::move(backup_scene);
                 cam = backup_cam;
                 mats = std::move(backup_mats);
-                scene.update_beams(mats);
-                scene.build_bvh();
+                refresh_scene(mats);
                 std::cerr << "Failed to load next level: " << next_path << "\n";
                 return false;
         };
@@ -1198,7 +1050,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                         refocus_game();
                 }
         };
-        while (SDL_PollEvent(&e))
+        while (g_input_recorder.poll_event(e))
         {
                 if (e.type == SDL_QUIT)
                         st.running = false;
@@ -1284,8 +1136,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                         mats[mid].checkered = false;
                         mats[mid].color = mats[mid].base_color;
                         scene.objects.erase(scene.objects.begin() + st.selected_obj);
-                        scene.update_beams(mats);
-                        scene.build_bvh();
+                        refresh_scene(mats);
                         mark_scene_dirty(st);
                         st.selected_obj = st.selected_mat = -1;
                         st.edit_mode = false;
@@ -1304,28 +1155,27 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                                 double yaw = -e.motion.xrel * sens;
                                 if (yaw != 0.0)
                                 {
-                                        scene.objects[st.selected_obj]->rotate(cam.up, yaw);
+                                        scene.rotate_object(st.selected_obj, cam.up, yaw);
                                         if (!g_developer_mode && scene.collides(st.selected_obj))
-                                                scene.objects[st.selected_obj]->rotate(
-                                                        cam.up, -yaw);
+                                                scene.rotate_object(st.selected_obj,
+                                                                    cam.up, -yaw);
                                         else
                                                 changed = true;
                                 }
                                 double pitch = -e.motion.yrel * sens;
                                 if (pitch != 0.0)
                                 {
-                                        scene.objects[st.selected_obj]->rotate(cam.right,
-                                                                                                          pitch);
+                                        scene.rotate_object(st.selected_obj, cam.right,
+                                                            pitch);
                                         if (!g_developer_mode && scene.collides(st.selected_obj))
-                                                scene.objects[st.selected_obj]->rotate(
-                                                        cam.right, -pitch);
+                                                scene.rotate_object(st.selected_obj,
+                                                                    cam.right, -pitch);
                                         else
                                                 changed = true;
                                 }
                                 if (changed)
                                 {
-                                        scene.update_beams(mats);
-                                        scene.build_bvh();
+                                        refresh_scene(mats);
                                         if (g_developer_mode)
                                                 mark_scene_dirty(st);
                                 }
@@ -1379,8 +1229,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                                                 default:
                                                         break;
                                                 }
-                                                scene.update_beams(mats);
-                                                scene.build_bvh();
+                                                refresh_scene(mats);
                                                 mark_scene_dirty(st);
                                         }
                                 }
@@ -1400,32 +1249,43 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                 else if (g_developer_mode && st.focused && e.type == SDL_KEYDOWN &&
                                  e.key.keysym.scancode == SDL_SCANCODE_C)
                 {
-                        scene.update_beams(mats);
-                        scene.build_bvh();
-                        if (MapSaver::save(st.scene_path, scene, cam, mats))
+                        refresh_scene(mats);
+                        st.autosaver.request(st.scene_path,
+                                             MapSaver::serialize(scene, cam, mats));
+                        std::error_code ec = st.autosaver.flush();
+                        if (!ec)
                         {
                                 std::cout << "Saved scene to: " << st.scene_path << "\n";
                                 st.scene_dirty = false;
-                                st.last_auto_save = SDL_GetTicks();
                         }
                         else
                         {
                                 std::cerr << "Failed to save scene to: " << st.scene_path
-                                          << "\n";
-                                st.last_auto_save = SDL_GetTicks();
+                                          << ": " << ec.message() << "\n";
                         }
                 }
+                else if (g_developer_mode && st.focused && e.type == SDL_KEYDOWN &&
+                                 e.key.keysym.scancode == SDL_SCANCODE_P)
+                {
+                        const char *trace_path = "minirt_trace.json";
+                        if (g_frame_profiler.write_chrome_trace(trace_path))
+                                std::cout << "Saved frame trace to: " << trace_path << "\n";
+                        else
+                                std::cerr << "Failed to save frame trace to: " << trace_path
+                                          << "\n";
+                }
                 else if (g_developer_mode && st.focused && e.type == SDL_KEYDOWN &&
                                  e.key.keysym.scancode == SDL_SCANCODE_R)
                 {
                         Scene backup_scene = scene;
                         Camera backup_cam = cam;
                         auto backup_mats = mats;
+                        // Reload what was saved last, not a half-written file.
+                        st.autosaver.flush();
                         if (Parser::parse_rt_file(st.scene_path, scene, cam, W, H))
                         {
                                 mats = Parser::get_materials();
-                                scene.update_beams(mats);
-                                scene.build_bvh();
+                                refresh_scene(mats);
                                 st.tutorial_prompts = scene.prompts;
                                 st.tutorial_prompt_index = 0;
                                 st.tutorial_prompt_shown_at = SDL_GetTicks();
@@ -1440,7 +1300,6 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                                 st.edit_dist = 0.0;
                                 st.edit_pos = Vec3();
                                 st.scene_dirty = false;
-                                st.last_auto_save = SDL_GetTicks();
                                 std::cout << "Reloaded scene from: " << st.scene_path << "\n";
                         }
                         else
@@ -1448,8 +1307,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                                 scene = std::move(backup_scene);
                                 cam = backup_cam;
                                 mats = std::move(backup_mats);
-                                scene.update_beams(mats);
-                                scene.build_bvh();
+                                refresh_scene(mats);
                                 std::cerr << "Failed to reload scene from: " << st.scene_path
                                           << "\n";
                         }
@@ -1517,8 +1375,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                                                                                                  removed_obj.get();
                                                                           }),
                                                            scene.objects.end());
-                                        scene.update_beams(mats);
-                                        scene.build_bvh();
+                                        refresh_scene(mats);
                                         mark_scene_dirty(st);
                                         st.selected_obj = st.selected_mat = -1;
                                         st.edit_mode = false;
@@ -1693,8 +1550,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
                                         selected_mat = marker_mat_id;
                                 }
 
-                                scene.update_beams(mats);
-                                scene.build_bvh();
+                                refresh_scene(mats);
                                 mark_scene_dirty(st);
 
                                 st.selected_obj = -1;
@@ -1818,7 +1674,7 @@ void Renderer::process_events(RenderState &st, SDL_Window *win, SDL_Renderer *re
 void Renderer::handle_keyboard(RenderState &st, double dt,
                                                           std::vector<Material> &mats)
 {
-        const Uint8 *state = SDL_GetKeyboardState(nullptr);
+        const Uint8 *state = g_input_recorder.keyboard_state();
         Vec3 forward_xz = cam.forward;
         forward_xz.y = 0.0;
         if (forward_xz.length_squared() > 0.0)
@@ -1847,26 +1703,25 @@ void Renderer::handle_keyboard(RenderState &st, double dt,
                                   scene.objects[st.selected_obj]->rotatable;
                 if (can_rotate && state[SDL_SCANCODE_Q])
                 {
-                        scene.objects[st.selected_obj]->rotate(cam.forward, -rot_speed);
+                        scene.rotate_object(st.selected_obj, cam.forward, -rot_speed);
                         if (!g_developer_mode && scene.collides(st.selected_obj))
-                                scene.objects[st.selected_obj]->rotate(cam.forward,
-                                                                                                      rot_speed);
+                                scene.rotate_object(st.selected_obj, cam.forward,
+                                                    rot_speed);
                         else
                                 changed = true;
                 }
                 if (can_rotate && state[SDL_SCANCODE_E])
                 {
-                        scene.objects[st.selected_obj]->rotate(cam.forward, rot_speed);
+                        scene.rotate_object(st.selected_obj, cam.forward, rot_speed);
                         if (!g_developer_mode && scene.collides(st.selected_obj))
-                                scene.objects[st.selected_obj]->rotate(cam.forward,
-                                                                                                      -rot_speed);
+                                scene.rotate_object(st.selected_obj, cam.forward,
+                                                    -rot_speed);
                         else
                                 changed = true;
                 }
                 if (changed)
                 {
-                        scene.update_beams(mats);
-                        scene.build_bvh();
+                        refresh_scene(mats);
                         if (g_developer_mode)
                                 mark_scene_dirty(st);
                 }
@@ -1976,8 +1831,7 @@ void Renderer::update_selection(RenderState &st,
                         st.edit_pos += applied;
                         if (applied.length_squared() > 0)
                         {
-                                scene.update_beams(mats);
-                                scene.build_bvh();
+                                refresh_scene(mats);
                                 if (g_developer_mode)
                                         mark_scene_dirty(st);
                         }
@@ -2769,42 +2623,175 @@ int Renderer::render_hud(const RenderState &st, SDL_Renderer *ren, int W, int H)
         return top_bar_height;
 }
 
-/// Render the current frame and display it to the window.
-void Renderer::render_frame(RenderState &st, SDL_Renderer *ren, SDL_Texture *tex,
-                                                       std::vector<Vec3> &framebuffer,
-                                                       std::vector<unsigned char> &pixels,
-                                                       int RW, int RH, int W, int H, int T,
-                                                       std::vector<Material> &mats)
-{
-        std::atomic<int> next_row{0};
-        auto worker = [&](int index)
+/// Trace the scene into framebuffer with the current quality settings,
+/// keeping the checkerboard history in st. Returns the rays traced.
+long long Renderer::trace_frame(RenderState &st, std::vector<ColorF> &framebuffer, int RW,
+                                int RH, int T, const std::vector<Material> &mats)
+{
+        auto trace_start = std::chrono::steady_clock::now();
+        // Beams and attached lights move between frames, so light culling
+        // is redone every frame before any shading.
+        st.light_grid.build(scene.lights);
+        // The checkerboard preset traces every other pixel and replaces
+        // foveation; it is not combined with dynamic resolution.
+        const bool checkerboard = g_settings.quality == 'C' && g_settings.target_fps <= 0;
+        const int parity = st.checker_parity;
+        FoveationPattern pattern;
+        pattern.enabled = g_settings.foveated && !checkerboard;
+        pattern.width = RW;
+        pattern.height = RH;
+        const Camera *prev_cam = nullptr;
+        if (checkerboard)
+        {
+                st.depth.resize(static_cast<size_t>(RW) * RH);
+                // Geometry edits also move beams and spotlights, so old colours
+                // cannot be trusted even where the depth still matches.
+                if (st.history_cam && st.history_w == RW && st.history_h == RH &&
+                    st.history_geometry == scene.geometry_revision)
+                        prev_cam = &*st.history_cam;
+        }
+        auto traced = [&](int x, int y)
+        { return checkerboard ? checker_traced(x, y, parity) : pattern.traced(x, y); };
+        const PixelGrid grid = cam.pixel_grid(RW, RH);
+        const int tiles_x = (RW + kWavefrontTile - 1) / kWavefrontTile;
+        const int tiles_y = (RH + kWavefrontTile - 1) / kWavefrontTile;
+        std::atomic<int> next_tile{0};
+        std::atomic<long long> rays{0};
+        auto worker = [&]()
         {
-                std::mt19937 rng(std::random_device{}());
-                std::uniform_real_distribution<double> dist(0.0, 1.0);
+                WavefrontScratch scratch;
+                long long traced_rays = 0;
+                float *depth = checkerboard ? st.depth.data() : nullptr;
                 for (;;)
                 {
-                        int y = next_row.fetch_add(1);
-                        if (y >= RH)
+                        int tile = next_tile.fetch_add(1);
+                        if (tile >= tiles_x * tiles_y)
                                 break;
-                        for (int x = 0; x < RW; ++x)
-                        {
-                                double u = (x + 0.5) / static_cast<double>(RW);
-                                double v = (y + 0.5) / static_cast<double>(RH);
-                                Ray r = cam.ray_through(u, v);
-                                Vec3 col = trace_ray(scene, mats, r, rng, dist, 0);
-                                framebuffer[y * RW + x] = col;
-                        }
-                }
+                        int x0 = (tile % tiles_x) * kWavefrontTile;
+                        int y0 = (tile / tiles_x) * kWavefrontTile;
+                        traced_rays += trace_tile_wavefront(
+                                scene, mats, st.light_grid, grid, x0, y0,
+                                std::min(x0 + kWavefrontTile, RW),
+                                std::min(y0 + kWavefrontTile, RH), RW, traced, framebuffer,
+                                depth, scratch);
+                }
+                rays += traced_rays;
+                ray_stats::flush();
         };
 
         std::vector<std::thread> pool;
         pool.reserve(T);
         for (int i = 0; i < T; ++i)
-                pool.emplace_back(worker, i);
+                pool.emplace_back(worker);
         for (auto &th : pool)
                 th.join();
+        if (pattern.enabled || checkerboard)
+        {
+                // Skipped pixels only read traced pixels, so rows can be
+                // filled in place and in parallel.
+                std::atomic<int> next_fill{0};
+                auto fill = [&]()
+                {
+                        for (;;)
+                        {
+                                int y = next_fill.fetch_add(1);
+                                if (y >= RH)
+                                        break;
+                                for (int x = 0; x < RW; ++x)
+                                {
+                                        int i = y * RW + x;
+                                        if (checkerboard)
+                                        {
+                                                if (checker_traced(x, y, parity))
+                                                        continue;
+                                                float d = kNoDepth;
+                                                framebuffer[i] = ColorF(reconstruct_checker(
+                                                        cam, prev_cam, framebuffer, st.depth,
+                                                        st.history_color, st.history_depth, RW,
+                                                        RH, x, y, d));
+                                                st.depth[i] = d;
+                                        }
+                                        else if (!pattern.traced(x, y))
+                                        {
+                                                framebuffer[i] = ColorF(
+                                                        reconstruct_foveated(framebuffer, pattern, x, y));
+                                        }
+                                }
+                        }
+                };
+                pool.clear();
+                for (int i = 0; i < T; ++i)
+                        pool.emplace_back(fill);
+                for (auto &th : pool)
+                        th.join();
+        }
+        if (checkerboard)
+        {
+                st.history_color.assign(framebuffer.begin(),
+                                        framebuffer.begin() + static_cast<size_t>(RW) * RH);
+                std::swap(st.history_depth, st.depth);
+                st.history_cam = cam;
+                st.history_geometry = scene.geometry_revision;
+                st.history_w = RW;
+                st.history_h = RH;
+                st.checker_parity ^= 1;
+        }
+        st.last_trace_ms = std::chrono::duration<double, std::milli>(
+                                   std::chrono::steady_clock::now() - trace_start)
+                                   .count();
+        return rays;
+}
+
+/// Stacked bars of the per-stage times of the last frames, oldest on the
+/// left, with a line at 60 FPS. The graph is 33 ms high.
+static void draw_profile_graph(SDL_Renderer *ren, int x, int bottom, int height)
+{
+        static const SDL_Color kStageColors[static_cast<int>(ProfileStage::Count)] = {
+                {230, 25, 75, 255},  {60, 180, 75, 255},  {255, 225, 25, 255},
+                {0, 130, 200, 255},  {245, 130, 48, 255}, {145, 30, 180, 255},
+                {70, 240, 240, 255}, {240, 50, 230, 255}, {210, 245, 60, 255},
+                {250, 190, 212, 255}, {0, 128, 128, 255}};
+        const double px_per_ms = height / 33.3;
+        const int count = g_frame_profiler.frame_count();
+        for (int age = 0; age < count; ++age)
+        {
+                const FrameProfiler::Frame &f = g_frame_profiler.frame(age);
+                int bar_x = x + (count - 1 - age) * 2;
+                double y = bottom;
+                for (int s = 0; s < static_cast<int>(ProfileStage::Count); ++s)
+                {
+                        double h = f.stage_ms[s] * px_per_ms;
+                        if (h <= 0.0)
+                                continue;
+                        double top = std::max(y - h, static_cast<double>(bottom - height));
+                        SDL_Rect bar{bar_x, static_cast<int>(top), 2,
+                                     std::max(1, static_cast<int>(y) - static_cast<int>(top))};
+                        const SDL_Color &c = kStageColors[s];
+                        SDL_SetRenderDrawColor(ren, c.r, c.g, c.b, c.a);
+                        SDL_RenderFillRect(ren, &bar);
+                        y = top;
+                }
+        }
+        int budget_y = bottom - static_cast<int>(16.7 * px_per_ms);
+        SDL_SetRenderDrawColor(ren, 255, 255, 255, 255);
+        SDL_RenderDrawLine(ren, x, budget_y, x + FrameProfiler::kHistory * 2, budget_y);
+}
 
-        st.last_score = compute_beam_score(scene, mats);
+/// Render the current frame and display it to the window.
+void Renderer::render_frame(RenderState &st, SDL_Renderer *ren, SDL_Texture *tex,
+                                                       std::vector<ColorF> &framebuffer,
+                                                       std::vector<unsigned char> &pixels,
+                                                       int RW, int RH, int W, int H, int T,
+                                                       std::vector<Material> &mats)
+{
+        {
+                ProfileScope scope(ProfileStage::Trace);
+                trace_frame(st, framebuffer, RW, RH, T, mats);
+        }
+        {
+                ProfileScope scope(ProfileStage::Score);
+                st.last_score = compute_beam_score(scene, mats);
+        }
 
         bool quota_defined = (scene.minimal_score > 0.0) || scene.target_required;
         bool score_met = (scene.minimal_score <= 0.0) ||
@@ -2813,28 +2800,22 @@ void Renderer::render_frame(RenderState &st, SDL_Renderer *ren, SDL_Texture *tex
         st.quota_defined = quota_defined;
         st.quota_met = quota_defined && score_met && target_met;
 
-        for (int y = 0; y < RH; ++y)
+        // The texture may be larger than the traced area when dynamic
+        // resolution is active, so only the top-left RW x RH block is used.
+        SDL_Rect traced_rect{0, 0, RW, RH};
         {
-                for (int x = 0; x < RW; ++x)
-                {
-                        Vec3 c = framebuffer[y * RW + x];
-                        c.x = std::clamp(c.x, 0.0, 1.0);
-                        c.y = std::clamp(c.y, 0.0, 1.0);
-                        c.z = std::clamp(c.z, 0.0, 1.0);
-                        pixels[(y * RW + x) * 3 + 0] =
-                                static_cast<unsigned char>(std::lround(c.x * 255.0));
-                        pixels[(y * RW + x) * 3 + 1] =
-                                static_cast<unsigned char>(std::lround(c.y * 255.0));
-                        pixels[(y * RW + x) * 3 + 2] =
-                                static_cast<unsigned char>(std::lround(c.z * 255.0));
-                }
+                ProfileScope scope(ProfileStage::Convert);
+                pack_rgba8(framebuffer.data(), static_cast<size_t>(RW) * RH, pixels.data());
+                SDL_UpdateTexture(tex, &traced_rect, pixels.data(), RW * 4);
         }
-
-        SDL_UpdateTexture(tex, nullptr, pixels.data(), RW * 3);
         SDL_SetRenderDrawColor(ren, 255, 255, 255, 255);
         SDL_RenderClear(ren);
-        SDL_RenderCopy(ren, tex, nullptr, nullptr);
-        int top_bar_height = render_hud(st, ren, W, H);
+        SDL_RenderCopy(ren, tex, &traced_rect, nullptr);
+        int top_bar_height = 0;
+        {
+                ProfileScope scope(ProfileStage::Hud);
+                top_bar_height = render_hud(st, ren, W, H);
+        }
         int legend_base_y = top_bar_height + 5;
         if (st.edit_mode && g_developer_mode)
         {
@@ -2912,7 +2893,7 @@ void Renderer::render_frame(RenderState &st, SDL_Renderer *ren, SDL_Texture *tex
                 const char *legend[] = {"1-PLANE",      "2-SPHERE",      "3-CUBE",
                                          "4-CONE",       "5-CYLINDER",  "6-BEAM SRC",
                                          "7-BEAM TARGET", "8-LIGHT",     "LALT-TYPE",
-                                         "SCROLL-SIZE",  "MCLICK-DEL"};
+                                         "SCROLL-SIZE",  "MCLICK-DEL",  "P-SAVE TRACE"};
                 int legend_count = static_cast<int>(std::size(legend));
                 for (int i = 0; i < legend_count; ++i)
                         CustomCharacter::draw_text(ren, legend[i], 5,
@@ -2922,18 +2903,69 @@ void Renderer::render_frame(RenderState &st, SDL_Renderer *ren, SDL_Texture *tex
                 int tw = CustomCharacter::text_width(text, scale);
                 CustomCharacter::draw_text(ren, text, W - tw - 5, 5, red, scale);
                 double fps_value = std::min(st.fps, 9999.9);
-                char fps_buf[32];
-                std::snprintf(fps_buf, sizeof(fps_buf), "FPS: %.1f", fps_value);
+                char fps_buf[64];
+                if (g_settings.target_fps > 0)
+                        std::snprintf(fps_buf, sizeof(fps_buf), "RES: %dX%d FPS: %.1f", RW,
+                                      RH, fps_value);
+                else
+                        std::snprintf(fps_buf, sizeof(fps_buf), "FPS: %.1f", fps_value);
                 std::string fps_text(fps_buf);
                 int fps_w = CustomCharacter::text_width(fps_text, scale);
                 int fps_h = 7 * scale;
                 int fps_x = std::max(0, W - fps_w - 5);
                 int fps_y = std::max(0, H - fps_h - 5);
                 CustomCharacter::draw_text(ren, fps_text, fps_x, fps_y, red, scale);
+                if (ray_stats::kEnabled)
+                {
+                        const RayCounters &rs = st.ray_stats;
+                        auto kilo = [](unsigned long long n) { return n / 1000.0; };
+                        auto rays = [&](RayKind k) { return rs.rays[static_cast<int>(k)]; };
+                        char lines[2][96];
+                        std::snprintf(lines[0], sizeof(lines[0]),
+                                      "RAYS P:%.0fK S:%.0fK M:%.0fK T:%.0fK B:%llu SC:%llu",
+                                      kilo(rays(RayKind::Primary)), kilo(rays(RayKind::Shadow)),
+                                      kilo(rays(RayKind::Mirror)),
+                                      kilo(rays(RayKind::Transparency)), rays(RayKind::Beam),
+                                      rays(RayKind::Score));
+                        std::snprintf(lines[1], sizeof(lines[1]),
+                                      "NODES:%.0fK BOX:%.0fK PRIM:%.0fK", kilo(rs.nodes),
+                                      kilo(rs.box_tests), kilo(rs.total_primitive_tests()));
+                        for (int i = 0; i < 2; ++i)
+                        {
+                                int w = CustomCharacter::text_width(lines[i], scale);
+                                int y = fps_y - (2 - i) * (fps_h + 4);
+                                CustomCharacter::draw_text(ren, lines[i], std::max(0, W - w - 5),
+                                                           std::max(0, y), red, scale);
+                        }
+                }
+                draw_profile_graph(ren, 5, H - 5, 70);
         }
         SDL_RenderPresent(ren);
 }
 
+void Renderer::prepare_offline(OfflineFrame &frame, int width, int height) const
+{
+	frame.width = width;
+	frame.height = height;
+	frame.grid = cam.pixel_grid(width, height);
+	frame.light_grid.build(scene.lights);
+}
+
+void Renderer::trace_rows(const OfflineFrame &frame, int y_begin, int y_end,
+						  const std::vector<Material> &mats, Vec3 *out) const
+{
+	const PixelGrid &grid = frame.grid;
+	for (int y = y_begin; y < y_end; ++y)
+	{
+		Vec3 dir = grid.direction(0, y);
+		for (int x = 0; x < frame.width; ++x, dir += grid.dx)
+		{
+			Ray r(grid.origin, dir.normalized());
+			*out++ = trace_ray(scene, mats, frame.light_grid, r);
+		}
+	}
+}
+
 void Renderer::render_ppm(const std::string &path,
 						  const std::vector<Material> &mats,
 						  const RenderSettings &rset)
@@ -2947,27 +2979,30 @@ void Renderer::render_ppm(const std::string &path,
 							 ? (int)std::thread::hardware_concurrency()
 							 : 8);
 
-	std::vector<Vec3> framebuffer(W * H);
-	std::atomic<int> next_row{0};
+	OfflineFrame frame;
+	prepare_offline(frame, W, H);
+	ImageWriter writer;
+	if (!writer.open(path, W, H))
+	{
+		std::cerr << "Failed to open image: " << path << "\n";
+		return;
+	}
 
+	// Rows go to the writer as soon as they are traced, so conversion and
+	// encoding overlap with tracing instead of following the whole frame.
+	std::atomic<int> next_row{0};
 	auto worker = [&]()
 	{
-		std::mt19937 rng(std::random_device{}());
-		std::uniform_real_distribution<double> dist(0.0, 1.0);
+		std::vector<Vec3> row(W);
 		for (;;)
 		{
 			int y = next_row.fetch_add(1);
 			if (y >= H)
 				break;
-			for (int x = 0; x < W; ++x)
-			{
-				double u = (x + 0.5) / W;
-				double v = (y + 0.5) / H;
-				Ray r = cam.ray_through(u, v);
-				Vec3 col = trace_ray(scene, mats, r, rng, dist);
-				framebuffer[y * W + x] = col;
-			}
+			trace_rows(frame, y, y + 1, mats, row.data());
+			writer.write_rows(y, row.data(), 1);
 		}
+		ray_stats::flush();
 	};
 
 	std::vector<std::thread> pool;
@@ -2977,25 +3012,8 @@ void Renderer::render_ppm(const std::string &path,
 	for (auto &th : pool)
 		th.join();
 
-	std::ofstream out(path, std::ios::binary);
-	out << "P6\n" << W << " " << H << "\n255\n";
-	for (int y = 0; y < H; ++y)
-	{
-		for (int x = 0; x < W; ++x)
-		{
-			Vec3 c = framebuffer[y * W + x];
-			c.x = std::clamp(c.x, 0.0, 1.0);
-			c.y = std::clamp(c.y, 0.0, 1.0);
-			c.z = std::clamp(c.z, 0.0, 1.0);
-			unsigned char r =
-				static_cast<unsigned char>(std::lround(c.x * 255.0));
-			unsigned char g =
-				static_cast<unsigned char>(std::lround(c.y * 255.0));
-			unsigned char b =
-				static_cast<unsigned char>(std::lround(c.z * 255.0));
-			out.put(r).put(g).put(b);
-		}
-	}
+	if (!writer.close())
+		std::cerr << "Failed to write image: " << path << "\n";
 }
 
 bool Renderer::render_window(std::vector<Material> &mats,
@@ -3006,6 +3024,8 @@ bool Renderer::render_window(std::vector<Material> &mats,
 {
         int W = rset.width;
         int H = rset.height;
+        // 'C' (checkerboard) traces at full resolution; render_frame halves
+        // the traced pixels instead.
         auto quality_scale = [](char q) -> float {
                 if (q == 'M' || q == 'm')
                         return 1.5f;
@@ -3013,7 +3033,12 @@ bool Renderer::render_window(std::vector<Material> &mats,
                         return 2.5f;
                 return 1.0f;
         };
-        float scale = std::max(1.0f, quality_scale(g_settings.quality));
+        // With a target frame rate the quality preset is ignored: the texture
+        // is kept at window size and each frame traces a sub-rectangle of it.
+        const bool dynamic_resolution = g_settings.target_fps > 0;
+        float scale = dynamic_resolution
+                              ? 1.0f
+                              : std::max(1.0f, quality_scale(g_settings.quality));
         int RW = std::max(1, static_cast<int>(W / scale));
         int RH = std::max(1, static_cast<int>(H / scale));
         const int T = (rset.threads > 0)
@@ -3054,16 +3079,37 @@ bool Renderer::render_window(std::vector<Material> &mats,
         SDL_SetWindowGrab(win, SDL_TRUE);
         SDL_WarpMouseInWindow(win, W / 2, H / 2);
 
-        std::vector<Vec3> framebuffer(RW * RH);
-        std::vector<unsigned char> pixels(RW * RH * 3);
+        std::vector<ColorF> framebuffer(RW * RH);
+        std::vector<unsigned char> pixels(RW * RH * 4);
         Uint32 last = SDL_GetTicks();
         char current_quality = g_settings.quality;
+        int tex_w = RW;
+        int tex_h = RH;
+        DynamicResolution dynres;
+        if (dynamic_resolution)
+                dynres.target_ms = 1000.0 / g_settings.target_fps;
+        bool view_known = false;
+        Vec3 last_cam_origin = cam.origin;
+        Vec3 last_cam_forward = cam.forward;
+        unsigned long last_geometry = scene.geometry_revision;
+        // Builds with MINIRT_RAY_STATS dump every frame's counters.
+        std::ofstream ray_dump;
+        if (ray_stats::kEnabled)
+        {
+                ray_dump.open("minirt_ray_stats.csv");
+                RayCounters::write_csv_header(ray_dump);
+        }
+        int frame_number = 0;
 
         while (st.running)
         {
                 Uint32 now = SDL_GetTicks();
                 double dt = (now - last) / 1000.0;
                 last = now;
+                if (!g_input_recorder.begin_frame(dt))
+                        break;
+                g_frame_profiler.begin_frame();
+                ray_stats::begin_frame();
                 if (dt > 1e-6)
                         st.fps = 1.0 / dt;
                 else
@@ -3084,7 +3130,7 @@ bool Renderer::render_window(std::vector<Material> &mats,
                 }
 
                 bool quality_changed = false;
-                if (g_settings.quality != current_quality)
+                if (!dynamic_resolution && g_settings.quality != current_quality)
                 {
                         current_quality = g_settings.quality;
                         scale = std::max(1.0f, quality_scale(current_quality));
@@ -3095,50 +3141,105 @@ bool Renderer::render_window(std::vector<Material> &mats,
                 {
                         int new_RW = std::max(1, static_cast<int>(W / scale));
                         int new_RH = std::max(1, static_cast<int>(H / scale));
-                        if (new_RW != RW || new_RH != RH)
+                        if (new_RW != tex_w || new_RH != tex_h)
                         {
                                 SDL_Texture *new_tex =
-                                        SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGB24,
+                                        SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA32,
                                                                           SDL_TEXTUREACCESS_STREAMING, new_RW,
                                                                           new_RH);
                                         if (!new_tex)
                                                 break;
                                 SDL_DestroyTexture(tex);
                                 tex = new_tex;
-                                RW = new_RW;
-                                RH = new_RH;
+                                tex_w = new_RW;
+                                tex_h = new_RH;
                         }
-                        framebuffer.assign(RW * RH, Vec3());
-                        pixels.assign(RW * RH * 3, 0);
+                        RW = new_RW;
+                        RH = new_RH;
+                        framebuffer.assign(RW * RH, ColorF());
+                        pixels.assign(RW * RH * 4, 0);
                         if (resolution_changed && st.focused)
                                 SDL_WarpMouseInWindow(win, W / 2, H / 2);
                 }
 
-                process_events(st, win, ren, W, H, mats, session);
-                handle_keyboard(st, dt, mats);
-                scene.update_goal_targets(dt, mats);
-                update_selection(st, mats);
-                if (st.scene_dirty)
+                {
+                        ProfileScope scope(ProfileStage::Events);
+                        process_events(st, win, ren, W, H, mats, session);
+                }
+                {
+                        ProfileScope scope(ProfileStage::Keyboard);
+                        handle_keyboard(st, dt, mats);
+                }
+                {
+                        ProfileScope scope(ProfileStage::Goals);
+                        scene.update_goal_targets(dt, mats);
+                }
+                {
+                        ProfileScope scope(ProfileStage::Selection);
+                        update_selection(st, mats);
+                }
+                // A recorded session must start from the same file when
+                // replayed, so edits are not saved while recording.
+                // Only the level text is built here; the autosaver writes it
+                // on its own thread.
+                if (st.scene_dirty && !g_input_recorder.active())
                 {
                         Uint32 now = SDL_GetTicks();
-                        if (now - st.last_auto_save >= 100)
+                        if (now - st.last_edit >= kAutosaveQuietMs ||
+                            now - st.dirty_since >= kAutosaveMaxDelayMs)
                         {
-                                if (MapSaver::save(st.scene_path, scene, cam, mats))
-                                {
-                                        st.scene_dirty = false;
-                                }
-                                else
-                                {
-                                        std::cerr << "Failed to save scene to: " << st.scene_path
-                                                  << "\n";
-                                }
-                                st.last_auto_save = now;
+                                ProfileScope scope(ProfileStage::Save);
+                                st.autosaver.request(st.scene_path,
+                                                     MapSaver::serialize(scene, cam, mats));
+                                st.scene_dirty = false;
+                        }
+                }
+                {
+                        std::string failed_path;
+                        std::error_code ec;
+                        if (st.autosaver.take_error(failed_path, ec))
+                        {
+                                std::cerr << "Failed to save scene to: " << failed_path << ": "
+                                          << ec.message() << "\n";
+                                // Try again with the next snapshot.
+                                if (failed_path == st.scene_path)
+                                        mark_scene_dirty(st);
                         }
                 }
+                if (dynamic_resolution)
+                {
+                        bool view_changed = !view_known ||
+                                            scene.geometry_revision != last_geometry ||
+                                            (cam.origin - last_cam_origin).length_squared() > 0.0 ||
+                                            (cam.forward - last_cam_forward).length_squared() > 0.0;
+                        view_known = true;
+                        last_cam_origin = cam.origin;
+                        last_cam_forward = cam.forward;
+                        last_geometry = scene.geometry_revision;
+                        record_frame_timing(dynres, st.last_trace_ms, dt * 1000.0, RW * RH);
+                        float dyn_scale = choose_dynamic_scale(dynres, W, H, view_changed);
+                        RW = std::clamp(static_cast<int>(W / dyn_scale), 1, tex_w);
+                        RH = std::clamp(static_cast<int>(H / dyn_scale), 1, tex_h);
+                }
                 render_frame(st, ren, tex, framebuffer, pixels, RW, RH, W, H, T,
                                          mats);
+                g_input_recorder.end_frame(st.last_trace_ms);
+                if (ray_stats::kEnabled)
+                {
+                        ray_stats::flush();
+                        st.ray_stats = ray_stats::frame_totals();
+                        st.ray_stats.write_csv(ray_dump, frame_number);
+                }
+                ++frame_number;
         }
 
+        // Edits from the last moments before closing; the autosaver writes
+        // them before render_window returns.
+        if (st.scene_dirty && !g_input_recorder.active())
+                st.autosaver.request(st.scene_path, MapSaver::serialize(scene, cam, mats));
+        if (std::error_code ec = st.autosaver.flush())
+                std::cerr << "Failed to save scene: " << ec.message() << "\n";
+
         if (session && !st.return_to_menu)
         {
                 session->has_progress = false;
@@ -3149,3 +3250,27 @@ bool Renderer::render_window(std::vector<Material> &mats,
         SDL_Quit();
         return st.return_to_menu;
 }
+
+/// Trace one frame without a window and time it, as render_frame would
+/// with the current quality settings. Checkerboard history is kept across
+/// calls.
+FrameTiming Renderer::render_offscreen(std::vector<ColorF> &framebuffer, int RW, int RH,
+                                       int T, std::vector<Material> &mats)
+{
+        if (!offscreen)
+                offscreen = std::make_unique<RenderState>();
+        if (framebuffer.size() < static_cast<size_t>(RW) * RH)
+                framebuffer.resize(static_cast<size_t>(RW) * RH);
+        FrameTiming timing;
+        ray_stats::begin_frame();
+        timing.rays = trace_frame(*offscreen, framebuffer, RW, RH, T, mats);
+        timing.trace_ms = offscreen->last_trace_ms;
+        auto score_start = std::chrono::steady_clock::now();
+        offscreen->last_score = compute_beam_score(scene, mats);
+        timing.score_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - score_start)
+                                  .count();
+        ray_stats::flush();
+        timing.counters = ray_stats::frame_totals();
+        return timing;
+}
@@ -1,10 +1,13 @@
 #include "Scene.hpp"
 #include "Camera.hpp"
 #include "Collision.hpp"
+#include "Config.hpp"
 #include "Laser.hpp"
 #include "Plane.hpp"
+#include "RayStats.hpp"
 #include "BeamTarget.hpp"
 #include "Settings.hpp"
+#include "Sphere.hpp"
 #include <algorithm>
 #include <cmath>
 #include <limits>
@@ -23,6 +26,24 @@ Vec3 material_surface_color(const Material &mat, const HitRecord &rec)
         return mat.base_color;
 }
 
+// For a pair sweep_collision reports as already in contact. False when
+// precise_collision confirms they overlap; otherwise n is the separating
+// axis as a unit vector from a towards b, or zero when there is none.
+bool contact_normal(const HittablePtr &a, const HittablePtr &b, Vec3 &n)
+{
+        Vec3 axis(0, 0, 0);
+        if (precise_collision(a, b, &axis))
+                return false;
+        AABB own, their;
+        n = Vec3(0, 0, 0);
+        if (axis.length_squared() == 0 || !a->bounding_box(own) || !b->bounding_box(their))
+                return true;
+        n = axis.normalized();
+        if (Vec3::dot(n, (their.min + their.max) - (own.min + own.max)) < 0)
+                n = n * -1;
+        return true;
+}
+
 } // namespace
 
 // Remove lights attached to beam segments and collect root laser objects.
@@ -100,6 +121,7 @@ void Scene::process_beams(const std::vector<Material> &mats,
                 objects.push_back(bm);
 
                 Ray forward(bm->path.orig, bm->path.dir);
+                ray_stats::count_ray(RayKind::Beam);
                 HitRecord tmp, hit_rec;
                 bool hit_any = false;
                 double closest = bm->length;
@@ -110,6 +132,7 @@ void Scene::process_beams(const std::vector<Material> &mats,
                         if (auto src = bm->source.lock())
                                 if (other.get() == src.get())
                                         continue;
+                        ray_stats::count_primitive(*other);
                         if (other->hit(forward, 1e-4, closest, tmp))
                         {
                                 closest = tmp.t;
@@ -255,6 +278,7 @@ void Scene::reflect_lights(const std::vector<Material> &mats)
                         seg.depth >= max_bounce)
                         continue;
                 Ray forward(L.position, L.direction.normalized());
+                ray_stats::count_ray(RayKind::Beam);
                 HitRecord tmp, hit_rec;
                 bool hit_any = false;
                 double closest = (L.range > 0.0) ? L.range : 1e9;
@@ -267,6 +291,7 @@ void Scene::reflect_lights(const std::vector<Material> &mats)
                         if (std::find(L.ignore_ids.begin(), L.ignore_ids.end(),
                                                   obj->object_id) != L.ignore_ids.end())
                                 continue;
+                        ray_stats::count_primitive(*obj);
                         if (obj->hit(forward, 1e-4, closest, tmp))
                         {
                                 closest = tmp.t;
@@ -315,6 +340,8 @@ void Scene::update_goal_targets(double dt, std::vector<Material> &mats)
 // Construct a bounding volume hierarchy for faster ray queries.
 void Scene::build_bvh()
 {
+	++geometry_revision;
+	spatial.sync(objects);
 	std::vector<HittablePtr> objs;
 	objs.reserve(objects.size());
 	for (auto &o : objects)
@@ -345,25 +372,113 @@ Vec3 Scene::move_with_collision(int index, const Vec3 &delta)
                 return delta;
         }
 
-        apply_translation(object, delta);
-        if (!collides(index))
+        double toi;
+        Vec3 normal;
+        if (!sweep(index, delta, toi, normal))
         {
+                apply_translation(object, delta);
                 return delta;
         }
-        apply_translation(object, delta * -1);
+        if (normal.length_squared() == 0)
+        {
+                return Vec3(0, 0, 0);
+        }
+        Vec3 moved = delta * toi;
+        apply_translation(object, moved);
+
+        // Slide the rest of the motion along the contact surface; one more
+        // sweep keeps the slide from pushing into a neighbour.
+        Vec3 rest = delta - moved;
+        double into = Vec3::dot(rest, normal);
+        if (into > 0)
+        {
+                rest = rest - normal * into;
+        }
+        if (rest.length_squared() <= 1e-12)
+        {
+                return moved;
+        }
+        if (sweep(index, rest, toi, normal))
+        {
+                rest = normal.length_squared() > 0 ? rest * toi : Vec3(0, 0, 0);
+        }
+        apply_translation(object, rest);
+        return moved + rest;
+}
 
-        Vec3 moved;
-        moved = Vec3(0, 0, 0);
+// First contact when object index moves by delta. False when the whole
+// delta is free; a zero normal means the object already overlaps
+// something and would still overlap it after the move.
+bool Scene::sweep(int index, const Vec3 &delta, double &toi, Vec3 &normal)
+{
+        HittablePtr object = objects[index];
+        std::vector<HittablePtr> candidates;
+        AABB box;
+        if (!object->is_plane() && object->bounding_box(box))
+        {
+                AABB moved_box(box.min + delta, box.max + delta);
+                AABB range = AABB::surrounding_box(box, moved_box);
+                Vec3 pad(kContactDistance, kContactDistance, kContactDistance);
+                query_neighbours(AABB(range.min - pad, range.max + pad), candidates);
+                for (auto &o : objects)
+                        if (o->is_plane())
+                                candidates.push_back(o);
+        }
+        else
+        {
+                candidates = objects;
+        }
 
-        Vec3 axis_deltas[3];
-        axis_deltas[0] = Vec3(delta.x, 0, 0);
-        axis_deltas[1] = Vec3(0, delta.y, 0);
-        axis_deltas[2] = Vec3(0, 0, delta.z);
-        for (const Vec3 &axis_delta : axis_deltas)
+        bool hit = false;
+        std::vector<HittablePtr> overlapping;
+        for (auto &cand : candidates)
+        {
+                if (cand.get() == object.get() || cand->is_beam())
+                        continue;
+                if (object->is_plane() && cand->is_plane())
+                        continue;
+                double t;
+                Vec3 n;
+                if (!sweep_collision(*object, delta, *cand, t, n))
+                        continue;
+                if (n.length_squared() == 0)
+                {
+                        // Only an overlap precise_collision confirms can pin
+                        // the object. Otherwise the pair merely touches, and
+                        // only motion across the separating axis is blocked.
+                        if (!contact_normal(object, cand, n))
+                        {
+                                overlapping.push_back(cand);
+                                continue;
+                        }
+                        if (Vec3::dot(delta, n) <= 0)
+                                continue;
+                        t = 0.0;
+                }
+                if (!hit || t < toi)
+                {
+                        toi = t;
+                        normal = n;
+                        hit = true;
+                }
+        }
+        if (!overlapping.empty())
         {
-                attempt_axis_move(index, axis_delta, moved);
+                // Same rule as the old discrete test: a move out of an
+                // existing overlap is fine, one that keeps it is not.
+                object->translate(delta);
+                bool stuck = false;
+                for (auto &o : overlapping)
+                        stuck = stuck || precise_collision(object, o);
+                object->translate(delta * -1);
+                if (stuck)
+                {
+                        toi = 0.0;
+                        normal = Vec3(0, 0, 0);
+                        return true;
+                }
         }
-        return moved;
+        return hit;
 }
 
 // Determine whether object is movable.
@@ -394,6 +509,7 @@ bool Scene::is_movable(int index) const
 void Scene::apply_translation(const HittablePtr &object, const Vec3 &delta)
 {
 	object->translate(delta);
+	spatial.update(object.get());
 	for (auto &light : lights)
 	{
 		if (light.attached_id == object->object_id)
@@ -403,29 +519,32 @@ void Scene::apply_translation(const HittablePtr &object, const Vec3 &delta)
 	}
 }
 
-// Try moving object along a single axis, updating moved vector on success.
-void Scene::attempt_axis_move(int index, const Vec3 &axis_delta, Vec3 &moved)
+// Rotate object and refresh its cells in the spatial hash.
+void Scene::rotate_object(int index, const Vec3 &axis, double angle)
 {
-	if (axis_delta.length_squared() == 0)
-	{
+	if (index < 0 || index >= static_cast<int>(objects.size()))
 		return;
-	}
-	HittablePtr object;
-	object = objects[index];
-	apply_translation(object, axis_delta);
-	if (collides(index))
-	{
-		apply_translation(object, axis_delta * -1);
-	}
-	else
+	objects[index]->rotate(axis, angle);
+	spatial.update(objects[index].get());
+}
+
+// Objects with finite bounds overlapping range. The spatial hash follows
+// moving objects; before the first build_bvh every object is returned.
+void Scene::query_neighbours(const AABB &range, std::vector<HittablePtr> &out) const
+{
+	if (!spatial.empty())
 	{
-		moved += axis_delta;
+		spatial.query(range, out);
+		return;
 	}
+	for (auto &o : objects)
+		if (!o->is_plane())
+			out.push_back(o);
 }
 
 // Move camera with collision avoidance.
 Vec3 Scene::move_camera(Camera &cam, const Vec3 &delta,
-                                                const std::vector<Material> &mats) const
+                        const std::vector<Material> &mats) const
 {
         if (g_developer_mode)
         {
@@ -433,48 +552,100 @@ Vec3 Scene::move_camera(Camera &cam, const Vec3 &delta,
                 return delta;
         }
 
-        auto blocked = [&](const Vec3 &start, const Vec3 &d)
-        {
-                double len = d.length();
-                if (len <= 0.0)
-                        return false;
-                Ray r(start, d / len);
-                HitRecord tmp;
-                for (const auto &obj : objects)
-                {
-                        if (obj->is_beam())
-                                continue;
-                        const Material &mat = mats[obj->material_id];
-                        if (mat.alpha < 1.0 && !obj->blocks_when_transparent())
-                                continue;
-                        if (obj->hit(r, 1e-4, len, tmp))
-                                return true;
-                }
-                return false;
-        };
-
-        Vec3 start = cam.origin;
-        if (!blocked(start, delta))
+        double toi;
+        Vec3 normal;
+        if (!sweep_camera(cam.origin, delta, mats, toi, normal))
         {
                 cam.move(delta);
                 return delta;
         }
+        Vec3 moved = delta * toi;
+        cam.move(moved);
 
-        Vec3 moved(0, 0, 0);
-        Vec3 axes[3] = {Vec3(delta.x, 0, 0), Vec3(0, delta.y, 0),
-                                        Vec3(0, 0, delta.z)};
-        for (const Vec3 &ax : axes)
+        // Slide along whatever stopped the camera, as dragged objects do.
+        Vec3 rest = delta - moved;
+        double into = Vec3::dot(rest, normal);
+        if (into > 0)
+        {
+                rest = rest - normal * into;
+        }
+        if (rest.length_squared() <= 1e-12)
+        {
+                return moved;
+        }
+        if (sweep_camera(cam.origin, rest, mats, toi, normal))
+        {
+                rest = normal.length_squared() > 0 ? rest * toi : Vec3(0, 0, 0);
+        }
+        cam.move(rest);
+        return moved + rest;
+}
+
+// Sweep the camera body, a sphere of CAMERA_COLLISION_RADIUS, along delta.
+// Candidates come from the spatial hash, so the cost follows the number of
+// nearby objects rather than the scene size. Transparent objects do not block.
+bool Scene::sweep_camera(const Vec3 &origin, const Vec3 &delta,
+                         const std::vector<Material> &mats, double &toi,
+                         Vec3 &normal) const
+{
+        double len = delta.length();
+        if (len <= 0.0)
         {
-                if (ax.length_squared() == 0)
+                return false;
+        }
+        auto body = std::make_shared<Sphere>(origin, CAMERA_COLLISION_RADIUS, -1, -1);
+        AABB box;
+        body->bounding_box(box);
+        AABB moved_box(box.min + delta, box.max + delta);
+        AABB range = AABB::surrounding_box(box, moved_box);
+        Vec3 pad(kContactDistance, kContactDistance, kContactDistance);
+        std::vector<HittablePtr> candidates;
+        query_neighbours(AABB(range.min - pad, range.max + pad), candidates);
+        for (auto &o : objects)
+                if (o->is_plane())
+                        candidates.push_back(o);
+
+        bool hit = false;
+        for (const auto &obj : candidates)
+        {
+                if (obj->is_beam())
                         continue;
-                if (!blocked(start, ax))
+                const Material &mat = mats[obj->material_id];
+                if (mat.alpha < 1.0 && !obj->blocks_when_transparent())
+                        continue;
+                double t;
+                Vec3 n;
+                if (!sweep_collision(*body, delta, *obj, t, n))
+                        continue;
+                if (n.length_squared() == 0)
                 {
-                        cam.move(ax);
-                        start += ax;
-                        moved += ax;
+                        if (contact_normal(body, obj, n))
+                        {
+                                // Touching: block only the motion into the
+                                // object, so move_camera slides along it.
+                                if (Vec3::dot(delta, n) <= 0)
+                                        continue;
+                                t = 0.0;
+                        }
+                        else
+                        {
+                                // Already inside, e.g. spawned there: let the
+                                // camera walk out, but not its centre through.
+                                HitRecord rec;
+                                if (!obj->hit(Ray(origin, delta / len), 1e-4, len, rec))
+                                        continue;
+                                t = std::max(0.0, (rec.t - 1e-3) / len);
+                                n = Vec3::dot(rec.normal, delta) > 0 ? rec.normal : rec.normal * -1;
+                        }
+                }
+                if (!hit || t < toi)
+                {
+                        toi = t;
+                        normal = n;
+                        hit = true;
                 }
         }
-        return moved;
+        return hit;
 }
 
 // Check if object at index intersects any other object.
@@ -506,26 +677,13 @@ bool Scene::collides(int index) const
 
 	std::vector<HittablePtr> candidates;
 	candidates.reserve(16);
-	if (accel && accel->is_bvh())
-	{
-		static_cast<BVHNode const *>(accel.get())->query(box, candidates);
-		candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
-										[](const HittablePtr &h)
-										{ return h->is_beam(); }),
-						 candidates.end());
-	}
-	else
-	{
-		for (auto &o : objects)
-			if (!o->is_plane() && !o->is_beam())
-				candidates.push_back(o);
-	}
+	query_neighbours(box, candidates);
 
 	for (auto &cand : candidates)
 	{
 		if (cand.get() == obj.get() || cand->is_beam())
 			continue;
-		if (precise_collision(obj, cand))
+		if (collision_cache.collide(obj, cand))
 			return true;
 	}
 
@@ -543,25 +701,70 @@ bool Scene::collides(int index) const
 // Ray-scene intersection test.
 bool Scene::hit(const Ray &r, double tmin, double tmax, HitRecord &rec) const
 {
+	// Shapes only write rec on a hit closer than their tmax, so every
+	// query can fill rec directly instead of going through a copy.
 	bool hit_any = false;
-	HitRecord tmp;
 	double closest = tmax;
-	if (accel && accel->hit(r, tmin, tmax, tmp))
+	if (accel && accel->hit(r, tmin, tmax, rec))
 	{
 		hit_any = true;
-		closest = tmp.t;
-		rec = tmp;
+		closest = rec.t;
 	}
 	for (auto &o : objects)
 	{
 		if (!o->is_plane())
 			continue;
-		if (o->hit(r, tmin, closest, tmp))
+		ray_stats::count_primitive(*o);
+		if (o->hit(r, tmin, closest, rec))
 		{
 			hit_any = true;
-			closest = tmp.t;
-			rec = tmp;
+			closest = rec.t;
 		}
 	}
 	return hit_any;
 }
+
+void Scene::hit_batch(RayBatch &batch, double tmin, double tmax) const
+{
+	size_t n = batch.rays.size();
+	batch.recs.resize(n);
+	batch.inv_dir.resize(n);
+	batch.tmax.assign(n, tmax);
+	batch.hit.assign(n, 0);
+	batch.lanes.clear();
+	for (size_t i = 0; i < n; ++i)
+	{
+		const Vec3 &d = batch.rays[i].dir;
+		batch.inv_dir[i] = Vec3(1.0 / d.x, 1.0 / d.y, 1.0 / d.z);
+		batch.lanes.push_back(static_cast<int>(i));
+	}
+	if (accel && accel->is_bvh())
+	{
+		static_cast<const BVHNode *>(accel.get())->hit_batch(batch, tmin, 0, n);
+	}
+	else if (accel)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (accel->hit(batch.rays[i], tmin, batch.tmax[i], batch.recs[i]))
+			{
+				batch.tmax[i] = batch.recs[i].t;
+				batch.hit[i] = 1;
+			}
+		}
+	}
+	for (auto &o : objects)
+	{
+		if (!o->is_plane())
+			continue;
+		ray_stats::count_primitive(*o, n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (o->hit(batch.rays[i], tmin, batch.tmax[i], batch.recs[i]))
+			{
+				batch.tmax[i] = batch.recs[i].t;
+				batch.hit[i] = 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,207 @@
+#include "SceneCache.hpp"
+#include "MapSaver.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <type_traits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+constexpr char kMagic[4] = {'R', 'T', 'B', 'N'};
+// Bump whenever SceneRecord or the meaning of its fields changes.
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrder = 0x01020304;
+
+static_assert(std::is_trivially_copyable<SceneRecord>::value,
+              "SceneRecord is stored as raw bytes");
+static_assert(sizeof(SceneRecord) == 80, "SceneRecord layout changed, bump kVersion");
+
+struct CacheHeader
+{
+        char magic[4];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t record_size;
+        uint64_t record_count;
+        uint64_t prompt_bytes;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint64_t checksum;
+};
+
+// FNV-1a over the payload, enough to reject a truncated or damaged file.
+uint64_t checksum(const unsigned char *bytes, size_t n)
+{
+        uint64_t h = 1469598103934665603ull;
+        for (size_t i = 0; i < n; ++i)
+        {
+                h ^= bytes[i];
+                h *= 1099511628211ull;
+        }
+        return h;
+}
+
+// Read-only view of a whole file; mapped where mmap exists.
+class FileView
+{
+        public:
+        explicit FileView(const std::string &path)
+        {
+#ifndef _WIN32
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                        return;
+                struct stat st;
+                if (::fstat(fd, &st) == 0 && st.st_size > 0)
+                {
+                        void *map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                                           MAP_PRIVATE, fd, 0);
+                        if (map != MAP_FAILED)
+                        {
+                                mapped = static_cast<const unsigned char *>(map);
+                                bytes = mapped;
+                                length = static_cast<size_t>(st.st_size);
+                        }
+                }
+                ::close(fd);
+                if (mapped)
+                        return;
+#endif
+                std::ifstream in(path, std::ios::binary);
+                if (!in)
+                        return;
+                buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                bytes = reinterpret_cast<const unsigned char *>(buffer.data());
+                length = buffer.size();
+        }
+        ~FileView()
+        {
+#ifndef _WIN32
+                if (mapped)
+                        ::munmap(const_cast<unsigned char *>(mapped), length);
+#endif
+        }
+        FileView(const FileView &) = delete;
+        FileView &operator=(const FileView &) = delete;
+
+        const unsigned char *bytes = nullptr;
+        size_t length = 0;
+
+        private:
+        const unsigned char *mapped = nullptr;
+        std::string buffer;
+};
+
+} // namespace
+
+namespace scene_cache
+{
+
+std::string path_for(const std::string &scene_path)
+{
+        return std::filesystem::path(scene_path).replace_extension(".rtbin").string();
+}
+
+bool stamp(const std::string &scene_path, SceneSourceStamp &out)
+{
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        uintmax_t size = fs::file_size(scene_path, ec);
+        if (ec)
+                return false;
+        fs::file_time_type mtime = fs::last_write_time(scene_path, ec);
+        if (ec)
+                return false;
+        out.size = static_cast<uint64_t>(size);
+        out.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+        return true;
+}
+
+bool load(const std::string &scene_path, const SceneSourceStamp &source, SceneSnapshot &out)
+{
+        FileView file(path_for(scene_path));
+        if (file.length < sizeof(CacheHeader))
+                return false;
+        CacheHeader header;
+        std::memcpy(&header, file.bytes, sizeof(header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+            header.byte_order != kByteOrder || header.record_size != sizeof(SceneRecord))
+                return false;
+        if (header.source_size != source.size || header.source_mtime != source.mtime)
+                return false;
+        size_t payload = file.length - sizeof(CacheHeader);
+        if (header.record_count > payload / sizeof(SceneRecord) ||
+            header.record_count * sizeof(SceneRecord) + header.prompt_bytes != payload)
+                return false;
+        const unsigned char *p = file.bytes + sizeof(CacheHeader);
+        if (checksum(p, payload) != header.checksum)
+                return false;
+
+        out.records.resize(static_cast<size_t>(header.record_count));
+        std::memcpy(out.records.data(), p, out.records.size() * sizeof(SceneRecord));
+        p += out.records.size() * sizeof(SceneRecord);
+        const unsigned char *end = file.bytes + file.length;
+        out.prompts.clear();
+        while (p < end)
+        {
+                uint32_t n;
+                if (static_cast<size_t>(end - p) < sizeof(n))
+                        return false;
+                std::memcpy(&n, p, sizeof(n));
+                p += sizeof(n);
+                if (static_cast<size_t>(end - p) < n)
+                        return false;
+                out.prompts.emplace_back(reinterpret_cast<const char *>(p), n);
+                p += n;
+        }
+        return true;
+}
+
+bool save(const std::string &scene_path, const SceneSourceStamp &source,
+          const SceneSnapshot &snapshot)
+{
+        size_t record_bytes = snapshot.records.size() * sizeof(SceneRecord);
+        size_t prompt_bytes = 0;
+        for (const std::string &prompt : snapshot.prompts)
+                prompt_bytes += sizeof(uint32_t) + prompt.size();
+
+        std::string contents(sizeof(CacheHeader) + record_bytes + prompt_bytes, '\0');
+        unsigned char *base = reinterpret_cast<unsigned char *>(&contents[0]);
+        unsigned char *p = base + sizeof(CacheHeader);
+        std::memcpy(p, snapshot.records.data(), record_bytes);
+        p += record_bytes;
+        for (const std::string &prompt : snapshot.prompts)
+        {
+                uint32_t n = static_cast<uint32_t>(prompt.size());
+                std::memcpy(p, &n, sizeof(n));
+                p += sizeof(n);
+                std::memcpy(p, prompt.data(), n);
+                p += n;
+        }
+
+        CacheHeader header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.byte_order = kByteOrder;
+        header.record_size = sizeof(SceneRecord);
+        header.record_count = snapshot.records.size();
+        header.prompt_bytes = prompt_bytes;
+        header.source_size = source.size;
+        header.source_mtime = source.mtime;
+        header.checksum = checksum(base + sizeof(CacheHeader), record_bytes + prompt_bytes);
+        std::memcpy(base, &header, sizeof(header));
+
+        std::error_code ec;
+        return MapSaver::write_atomic(path_for(scene_path), contents, ec);
+}
+
+} // namespace scene_cache
@@ -5,7 +5,7 @@
 #include <iomanip>
 #include <algorithm>
 
-GameSettings g_settings{'H', 1.0f, 1080, 720};
+GameSettings g_settings{'H', 1.0f, 1080, 720, 0, false};
 bool g_developer_mode = false;
 
 static std::string trim(const std::string &s) {
@@ -17,6 +17,10 @@ static std::string trim(const std::string &s) {
     return s.substr(start, end - start + 1);
 }
 
+static bool is_on(const std::string &value) {
+    return value == "On" || value == "ON" || value == "on" || value == "true";
+}
+
 void load_settings(const std::string &filename) {
     std::ifstream file(filename);
     if (!file)
@@ -33,6 +37,9 @@ void load_settings(const std::string &filename) {
                 g_settings.quality = 'L';
             else if (value == "Medium" || value == "MEDIUM" || value == "medium")
                 g_settings.quality = 'M';
+            else if (value == "Checkerboard" || value == "CHECKERBOARD" ||
+                     value == "checkerboard")
+                g_settings.quality = 'C';
             else
                 g_settings.quality = 'H';
         } else if (key == "mouse_sensitivity") {
@@ -44,6 +51,11 @@ void load_settings(const std::string &filename) {
                 g_settings.height =
                     std::strtol(value.substr(x + 1).c_str(), nullptr, 10);
             }
+        } else if (key == "target_fps") {
+            g_settings.target_fps =
+                std::max(0, static_cast<int>(std::strtol(value.c_str(), nullptr, 10)));
+        } else if (key == "foveated") {
+            g_settings.foveated = is_on(value);
         }
     }
 }
@@ -57,12 +69,16 @@ void save_settings(const std::string &filename) {
         file << "Low";
     else if (g_settings.quality == 'M')
         file << "Medium";
+    else if (g_settings.quality == 'C')
+        file << "Checkerboard";
     else
         file << "High";
     file << '\n';
     file << std::fixed << std::setprecision(1);
     file << "mouse_sensitivity: " << g_settings.mouse_sensitivity << '\n';
     file << "resolution: " << g_settings.width << 'x' << g_settings.height << '\n';
+    file << "target_fps: " << g_settings.target_fps << '\n';
+    file << "foveated: " << (g_settings.foveated ? "On" : "Off") << '\n';
 }
 
 double get_mouse_sensitivity() {
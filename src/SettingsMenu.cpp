@@ -211,13 +211,15 @@ void SettingsSection::draw(SDL_Renderer *renderer, int scale) const {
 
 QualitySection::QualitySection()
     : SettingsSection("QUALITY"),
-      cluster({"LOW", "MEDIUM", "HIGH"}) {
+      cluster({"LOW", "MEDIUM", "CHECKER", "HIGH"}) {
     if (g_settings.quality == 'L')
         cluster.selected = 0;
     else if (g_settings.quality == 'M')
         cluster.selected = 1;
-    else
+    else if (g_settings.quality == 'C')
         cluster.selected = 2;
+    else
+        cluster.selected = 3;
 }
 
 void QualitySection::layout(int x, int y, int width, int height, int scale) {
@@ -243,7 +245,10 @@ void QualitySection::draw(SDL_Renderer *renderer, int scale) const {
 }
 
 char QualitySection::current() const {
-    return cluster.selected == 0 ? 'L' : (cluster.selected == 1 ? 'M' : 'H');
+    static const char kQualities[] = {'L', 'M', 'C', 'H'};
+    if (cluster.selected < 0 || cluster.selected > 3)
+        return 'H';
+    return kQualities[cluster.selected];
 }
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,595 @@
+#include "Shading.hpp"
+#include "Laser.hpp"
+#include "RayStats.hpp"
+#include <algorithm>
+#include <cmath>
+
+static inline Vec3 mix_colors(const Vec3 &a, const Vec3 &b, double alpha)
+{
+        return a * (1.0 - alpha) + b * alpha;
+}
+
+static constexpr double kObjectAltColorAmount = 0.35;
+static constexpr double kPlaneAltColorAmount = 0.05;
+static constexpr double kObjectCheckerFrequency = 5.0;
+static constexpr double kPlaneCheckerFrequency = 0.25;
+
+static Vec3 brighten_color_by(const Vec3 &color, double amount)
+{
+        return Vec3(std::clamp(color.x + (1.0 - color.x) * amount, 0.0, 1.0),
+                                std::clamp(color.y + (1.0 - color.y) * amount, 0.0, 1.0),
+                                std::clamp(color.z + (1.0 - color.z) * amount, 0.0, 1.0));
+}
+
+static Vec3 darken_color_by(const Vec3 &color, double amount)
+{
+        double factor = 1.0 - amount;
+        return Vec3(std::clamp(color.x * factor, 0.0, 1.0),
+                                std::clamp(color.y * factor, 0.0, 1.0),
+                                std::clamp(color.z * factor, 0.0, 1.0));
+}
+
+Vec3 brighten_color(const Vec3 &color)
+{
+        return brighten_color_by(color, kObjectAltColorAmount);
+}
+
+Vec3 darken_color(const Vec3 &color)
+{
+        return darken_color_by(color, kObjectAltColorAmount);
+}
+
+static int compute_checker_from_position(const Vec3 &p, double frequency)
+{
+        return (static_cast<int>(std::floor(p.x * frequency)) +
+                        static_cast<int>(std::floor(p.y * frequency)) +
+                        static_cast<int>(std::floor(p.z * frequency))) &
+               1;
+}
+
+static int compute_checker_from_uv(double u, double v, double frequency)
+{
+        return (static_cast<int>(std::floor(u * frequency)) +
+                        static_cast<int>(std::floor(v * frequency))) &
+               1;
+}
+
+static Vec3 normalize_or(const Vec3 &v, const Vec3 &fallback = Vec3(0, 0, 1))
+{
+        double len2 = v.length_squared();
+        if (len2 <= 1e-12)
+                return fallback;
+        return v / std::sqrt(len2);
+}
+
+static bool beam_parameters(const PreparedLight &L, const Vec3 &point, double &axial_dist,
+                           double &radial_sq)
+{
+        if (!L.beam || !L.has_axis)
+                return false;
+        Vec3 rel = point - L.position;
+        axial_dist = Vec3::dot(rel, L.axis);
+        if (axial_dist < 0.0)
+                return false;
+        if (L.inv_range > 0.0 && axial_dist * L.inv_range > 1.0)
+                return false;
+        Vec3 radial = rel - L.axis * axial_dist;
+        radial_sq = radial.length_squared();
+        return radial_sq <= L.radius_sq;
+}
+
+static bool beam_light_through(const Scene &scene, const std::vector<Material> &mats,
+                               const Vec3 &p, const PreparedLight &L, double axis_dist,
+                               Vec3 &color, Vec3 &radiance)
+{
+        color = L.color;
+        radiance = L.radiance;
+        if (axis_dist <= 1e-6)
+                return true;
+        double intensity = L.intensity;
+        const std::vector<int> &ignore_ids = L.source->ignore_ids;
+        Vec3 dir = L.axis * -1.0;
+        Ray shadow_ray(p + dir * 1e-4, dir);
+        double max_dist = axis_dist - 1e-4;
+        while (max_dist > 1e-4)
+        {
+                ray_stats::count_ray(RayKind::Shadow);
+                HitRecord tmp;
+                bool hit_any = false;
+                double closest = max_dist;
+                int hit_mat = -1;
+                for (const auto &obj : scene.objects)
+                {
+                        if (!obj->casts_shadow())
+                                continue;
+                        if (obj->is_beam())
+                                continue;
+                        if (std::find(ignore_ids.begin(), ignore_ids.end(), obj->object_id) !=
+                            ignore_ids.end())
+                                continue;
+                        ray_stats::count_primitive(*obj);
+                        if (obj->hit(shadow_ray, 1e-4, closest, tmp))
+                        {
+                                closest = tmp.t;
+                                hit_mat = tmp.material_id;
+                                hit_any = true;
+                        }
+                }
+                if (!hit_any)
+                        break;
+                const Material &m = mats[hit_mat];
+                if (m.alpha >= 1.0)
+                        return false;
+                color = mix_colors(color, m.base_color, m.alpha);
+                intensity *= (1.0 - m.alpha);
+                radiance = color * intensity;
+                shadow_ray.orig = shadow_ray.orig + shadow_ray.dir * (closest + 1e-4);
+                max_dist -= closest + 1e-4;
+                if (intensity <= 1e-4)
+                        return false;
+        }
+        return true;
+}
+
+/// Shadow test towards a point light along the unit direction `dir` for
+/// `dist_to_light`. Transparent occluders tint `color` and scale `radiance`.
+static bool light_through(const Scene &scene, const std::vector<Material> &mats,
+                          const Vec3 &p, const PreparedLight &L, const Vec3 &dir,
+                          double dist_to_light, Vec3 &color, Vec3 &radiance)
+{
+        const std::vector<int> &ignore_ids = L.source->ignore_ids;
+        Ray shadow_ray(p + dir * 1e-4, dir);
+        double max_dist = dist_to_light - 1e-4;
+        color = L.color;
+        radiance = L.radiance;
+        double intensity = L.intensity;
+        while (max_dist > 1e-4)
+        {
+                ray_stats::count_ray(RayKind::Shadow);
+                HitRecord tmp;
+                bool hit_any = false;
+                double closest = max_dist;
+                int hit_mat = -1;
+                for (const auto &obj : scene.objects)
+                {
+                        if (!obj->casts_shadow())
+                                continue;
+                        if (obj->is_beam())
+                                continue;
+                        if (std::find(ignore_ids.begin(), ignore_ids.end(), obj->object_id) !=
+                            ignore_ids.end())
+                                continue;
+                        ray_stats::count_primitive(*obj);
+                        if (obj->hit(shadow_ray, 1e-4, closest, tmp))
+                        {
+                                closest = tmp.t;
+                                hit_mat = tmp.material_id;
+                                hit_any = true;
+                        }
+                }
+                if (!hit_any)
+                        break;
+                const Material &m = mats[hit_mat];
+                if (m.alpha >= 1.0)
+                        return false;
+                color = mix_colors(color, m.base_color, m.alpha);
+                intensity *= (1.0 - m.alpha);
+                radiance = color * intensity;
+                shadow_ray.orig = shadow_ray.orig + shadow_ray.dir * (closest + 1e-4);
+                max_dist -= closest + 1e-4;
+                if (intensity <= 1e-4)
+                        return false;
+        }
+        return true;
+}
+
+namespace
+{
+
+struct Basis
+{
+        Vec3 u;
+        Vec3 v;
+        Vec3 w;
+};
+
+Basis make_basis(const Vec3 &axis)
+{
+        Basis b{};
+        double len2 = axis.length_squared();
+        if (len2 <= 1e-12)
+        {
+                b.w = Vec3(0, 0, 1);
+                b.u = Vec3(1, 0, 0);
+                b.v = Vec3(0, 1, 0);
+                return b;
+        }
+        b.w = axis / std::sqrt(len2);
+        Vec3 helper = (std::abs(b.w.z) < 0.999) ? Vec3(0, 0, 1) : Vec3(0, 1, 0);
+        b.u = Vec3::cross(helper, b.w);
+        double ulen = b.u.length();
+        if (ulen <= 1e-12)
+        {
+                helper = Vec3(0, 1, 0);
+                b.u = Vec3::cross(helper, b.w);
+                ulen = b.u.length();
+        }
+        b.u = (ulen > 1e-12) ? b.u / ulen : Vec3(1, 0, 0);
+        b.v = Vec3::cross(b.w, b.u);
+        return b;
+}
+
+bool light_ignores(const PointLight &L, int object_id)
+{
+        return std::find(L.ignore_ids.begin(), L.ignore_ids.end(), object_id) !=
+               L.ignore_ids.end();
+}
+
+Vec3 clamp_color(const Vec3 &c, double lo = 0.0, double hi = 1.0)
+{
+        return Vec3(std::clamp(c.x, lo, hi), std::clamp(c.y, lo, hi),
+                                std::clamp(c.z, lo, hi));
+}
+
+} // namespace
+
+Vec3 surface_color_at(const Scene &scene, const HitRecord &rec, const Material &mat,
+                      bool use_base_state)
+{
+        Vec3 base = mat.base_color;
+        Vec3 col = use_base_state ? mat.base_color : mat.color;
+        bool is_plane = false;
+        if (rec.object_id >= 0 &&
+                rec.object_id < static_cast<int>(scene.objects.size()))
+        {
+                auto obj = scene.objects[rec.object_id];
+                if (obj->is_beam())
+                {
+                        auto beam = std::static_pointer_cast<Laser>(obj);
+                        base = col = beam->color;
+                }
+                else if (obj->is_plane())
+                {
+                        is_plane = true;
+                }
+        }
+        if (is_plane)
+        {
+                Vec3 brighter = brighten_color_by(base, kPlaneAltColorAmount);
+                Vec3 darker = darken_color_by(base, kPlaneAltColorAmount);
+                double u = rec.has_uv ? rec.u : rec.p.x;
+                double v = rec.has_uv ? rec.v : rec.p.y;
+                int chk = compute_checker_from_uv(u, v, kPlaneCheckerFrequency);
+                col = chk ? brighter : darker;
+        }
+        else if (!use_base_state && mat.checkered)
+        {
+                Vec3 brighter = brighten_color(base);
+                Vec3 darker = darken_color(base);
+                int chk = compute_checker_from_position(rec.p, kObjectCheckerFrequency);
+                col = chk ? brighter : darker;
+        }
+        return col;
+}
+
+double compute_effective_alpha(const Material &mat, const HitRecord &rec)
+{
+        double alpha = mat.alpha;
+        if (mat.random_alpha)
+        {
+                double tpos = std::clamp(static_cast<double>(rec.beam_ratio), 0.0, 1.0);
+                alpha *= (1.0 - tpos);
+        }
+        return std::clamp(alpha, 0.0, 1.0);
+}
+
+Vec3 ambient_contribution(const Scene &scene, const Vec3 &surface_color)
+{
+        return Vec3(surface_color.x * scene.ambient.color.x * scene.ambient.intensity,
+                                surface_color.y * scene.ambient.color.y * scene.ambient.intensity,
+                                surface_color.z * scene.ambient.color.z * scene.ambient.intensity);
+}
+
+Vec3 light_contribution(const Scene &scene, const std::vector<Material> &mats,
+                        const PreparedLight &light, const HitRecord &rec,
+                        const Vec3 &surface_color, const Material &mat,
+                        const Vec3 &point, const Vec3 &view_dir)
+{
+        const Vec3 black(0.0, 0.0, 0.0);
+        if (light_ignores(*light.source, rec.object_id))
+                return black;
+        Vec3 lcolor;
+        Vec3 radiance;
+        Vec3 ldir;
+        double atten = 1.0;
+        // Cheap geometric rejections go first; the shadow ray is traced only
+        // for points the light actually faces.
+        if (light.beam)
+        {
+                double axial_dist;
+                double radial_sq;
+                if (!beam_parameters(light, point, axial_dist, radial_sq))
+                        return black;
+                if (light.inv_range > 0.0)
+                {
+                        atten = 1.0 - axial_dist * light.inv_range;
+                        if (atten <= 0.0)
+                                return black;
+                }
+                ldir = light.axis * -1.0;
+                if (Vec3::dot(rec.normal, ldir) <= 1e-6)
+                        return black;
+                if (!beam_light_through(scene, mats, point, light, axial_dist, lcolor,
+                                        radiance))
+                        return black;
+        }
+        else
+        {
+                Vec3 to_light = light.position - point;
+                double dist = to_light.length();
+                if (dist <= 1e-6)
+                        return black;
+                if (light.inv_range > 0.0)
+                {
+                        atten = 1.0 - dist * light.inv_range;
+                        if (atten <= 0.0)
+                                return black;
+                }
+                ldir = to_light / dist;
+                if (light.cutoff_cos > -1.0 &&
+                    -Vec3::dot(light.direction, ldir) < light.cutoff_cos)
+                        return black;
+                if (Vec3::dot(rec.normal, ldir) <= 1e-6)
+                        return black;
+                if (!light_through(scene, mats, point, light, ldir, dist, lcolor, radiance))
+                        return black;
+        }
+        double diff = Vec3::dot(rec.normal, ldir);
+        double spec = 0.0;
+        if (mat.specular_k > 0.0)
+        {
+                Vec3 h = (ldir + view_dir).normalized();
+                spec = specular_power(std::max(0.0, Vec3::dot(rec.normal, h)),
+                                      mat.specular_exp) *
+                       mat.specular_k;
+        }
+        double diff_term = diff * atten;
+        double spec_term = spec * atten;
+        return Vec3(surface_color.x * radiance.x * diff_term + lcolor.x * spec_term,
+                    surface_color.y * radiance.y * diff_term + lcolor.y * spec_term,
+                    surface_color.z * radiance.z * diff_term + lcolor.z * spec_term);
+}
+
+double luminance(const Vec3 &c)
+{
+        return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
+namespace
+{
+
+// Lights seen by the score integration of one spotlight: the spotlight
+// itself and every other light, prepared once for all of its samples.
+struct SpotlightLights
+{
+        PreparedLight beam;
+        std::vector<PreparedLight> others;
+};
+
+SpotlightLights prepare_spotlight_lights(const Scene &scene, const PointLight &L)
+{
+        SpotlightLights lights{prepare_light(L), {}};
+        lights.others.reserve(scene.lights.size());
+        for (const auto &other : scene.lights)
+                if (&other != &L)
+                        lights.others.push_back(prepare_light(other));
+        return lights;
+}
+
+double trace_spotlight_sample(const Scene &scene, const std::vector<Material> &mats,
+                                                         const PointLight &L, const SpotlightLights &lights,
+                                                         const Vec3 &axis_dir, const Vec3 &sample_origin,
+                                                         double sample_area, int limit_object = -1)
+{
+        if (L.intensity <= 1e-4)
+                return 0.0;
+        Vec3 dir = normalize_or(axis_dir);
+        const double max_range = (L.range > 0.0) ? L.range : 1e9;
+        double travelled = 0.0;
+        Vec3 origin = sample_origin;
+        double transmittance = 1.0;
+        double total_area = 0.0;
+
+        while (travelled < max_range - 1e-4 && transmittance > 1e-4)
+        {
+                Ray ray(origin, dir);
+                ray_stats::count_ray(RayKind::Score);
+                double closest = max_range - travelled;
+                HitRecord rec;
+                bool hit_any = false;
+                Hittable *hit_obj = nullptr;
+                for (const auto &obj : scene.objects)
+                {
+                        if (obj->is_beam())
+                                continue;
+                        if (light_ignores(L, obj->object_id))
+                                continue;
+                        HitRecord tmp;
+                        ray_stats::count_primitive(*obj);
+                        if (obj->hit(ray, 1e-4, closest, tmp))
+                        {
+                                closest = tmp.t;
+                                rec = tmp;
+                                hit_any = true;
+                                hit_obj = obj.get();
+                        }
+                }
+                if (!hit_any)
+                        break;
+
+                travelled += closest;
+                Vec3 point = ray.at(closest);
+
+                if (hit_obj && hit_obj->scorable && !hit_obj->is_beam() &&
+                    (limit_object < 0 || hit_obj->object_id == limit_object))
+                {
+                        Vec3 ldir = dir * -1.0;
+                        double cos_incident =
+                                std::max(0.0, Vec3::dot(rec.normal, ldir));
+                        if (cos_incident > 1e-6)
+                        {
+                                const Material &mat = mats[rec.material_id];
+                                Vec3 surface_color =
+                                        surface_color_at(scene, rec, mat, true);
+                                Vec3 view_dir = rec.normal.normalized();
+                                Vec3 base = ambient_contribution(scene, surface_color);
+                                for (const PreparedLight &other : lights.others)
+                                        base += light_contribution(scene, mats, other, rec,
+                                                                   surface_color, mat, point,
+                                                                   view_dir);
+                                Vec3 beam_contrib = light_contribution(
+                                        scene, mats, lights.beam, rec, surface_color, mat,
+                                        point, view_dir);
+                                if (beam_contrib.length_squared() > 1e-12)
+                                {
+                                        Vec3 base_clamped = clamp_color(base);
+                                        Vec3 with_clamped =
+                                                clamp_color(base + beam_contrib);
+                                        Vec3 delta = with_clamped - base_clamped;
+                                        delta.x = std::max(0.0, delta.x);
+                                        delta.y = std::max(0.0, delta.y);
+                                        delta.z = std::max(0.0, delta.z);
+                                        double delta_luma = luminance(delta);
+                                        if (delta_luma > 1e-6)
+                                        {
+                                                double area = sample_area / cos_incident;
+                                                double alpha = compute_effective_alpha(mat, rec);
+                                                total_area += area * delta_luma * alpha;
+                                        }
+                                }
+                        }
+                }
+
+                const Material &mat = mats[rec.material_id];
+                double effective_alpha = compute_effective_alpha(mat, rec);
+                if (effective_alpha >= 1.0)
+                        break;
+
+                transmittance *= (1.0 - effective_alpha);
+                if (transmittance <= 1e-4)
+                        break;
+
+                travelled += 1e-4;
+                origin = point + dir * 1e-4;
+        }
+
+        return total_area;
+}
+
+} // namespace
+
+double integrate_spotlight_area(const Scene &scene, const std::vector<Material> &mats,
+                                const PointLight &L)
+{
+        if (!L.beam_spotlight || L.intensity <= 0.0)
+                return 0.0;
+        if (L.spot_radius <= 0.0)
+                return 0.0;
+        Basis basis = make_basis(L.direction);
+        Vec3 axis_dir = basis.w;
+        const int grid = 16;
+        double disk_area = M_PI * L.spot_radius * L.spot_radius;
+        if (disk_area <= 1e-12)
+                return 0.0;
+        double sample_area = disk_area / (grid * grid);
+        const SpotlightLights lights = prepare_spotlight_lights(scene, L);
+
+        double total = 0.0;
+        for (int iy = 0; iy < grid; ++iy)
+        {
+                for (int ix = 0; ix < grid; ++ix)
+                {
+                        double su = (ix + 0.5) / static_cast<double>(grid);
+                        double sv = (iy + 0.5) / static_cast<double>(grid);
+                        double radius = L.spot_radius * std::sqrt(su);
+                        double phi = 2.0 * M_PI * sv;
+                        Vec3 offset = basis.u * (std::cos(phi) * radius) +
+                                      basis.v * (std::sin(phi) * radius);
+                        Vec3 sample_origin = L.position + offset + axis_dir * 1e-4;
+                        total += trace_spotlight_sample(scene, mats, L, lights, axis_dir,
+                                                        sample_origin, sample_area);
+                }
+        }
+        return total;
+}
+
+double compute_beam_score(const Scene &scene, const std::vector<Material> &mats)
+{
+        double score = 0.0;
+        for (const auto &L : scene.lights)
+        {
+                if (!L.beam_spotlight)
+                        continue;
+                score += integrate_spotlight_area(scene, mats, L);
+        }
+        return score;
+}
+
+namespace
+{
+
+double integrate_spotlight_area_for_object(const Scene &scene,
+                                          const std::vector<Material> &mats,
+                                          const PointLight &L, int object_id)
+{
+        if (object_id < 0)
+                return 0.0;
+        if (!L.beam_spotlight || L.intensity <= 0.0)
+                return 0.0;
+        if (L.spot_radius <= 0.0)
+                return 0.0;
+        Basis basis = make_basis(L.direction);
+        Vec3 axis_dir = basis.w;
+        const int grid = 16;
+        double disk_area = M_PI * L.spot_radius * L.spot_radius;
+        if (disk_area <= 1e-12)
+                return 0.0;
+        double sample_area = disk_area / (grid * grid);
+        const SpotlightLights lights = prepare_spotlight_lights(scene, L);
+
+        double total = 0.0;
+        for (int iy = 0; iy < grid; ++iy)
+        {
+                for (int ix = 0; ix < grid; ++ix)
+                {
+                        double su = (ix + 0.5) / static_cast<double>(grid);
+                        double sv = (iy + 0.5) / static_cast<double>(grid);
+                        double radius = L.spot_radius * std::sqrt(su);
+                        double phi = 2.0 * M_PI * sv;
+                        Vec3 offset = basis.u * (std::cos(phi) * radius) +
+                                      basis.v * (std::sin(phi) * radius);
+                        Vec3 sample_origin = L.position + offset + axis_dir * 1e-4;
+                        total += trace_spotlight_sample(scene, mats, L, lights, axis_dir,
+                                                        sample_origin, sample_area,
+                                                        object_id);
+                }
+        }
+        return total;
+}
+
+} // namespace
+
+double compute_object_beam_score(const Scene &scene,
+                                const std::vector<Material> &mats, int object_id)
+{
+        if (object_id < 0)
+                return 0.0;
+        double score = 0.0;
+        for (const auto &L : scene.lights)
+        {
+                if (!L.beam_spotlight)
+                        continue;
+                score += integrate_spotlight_area_for_object(scene, mats, L, object_id);
+        }
+        return score;
+}
@@ -0,0 +1,246 @@
+#include "SpatialHash.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Objects spanning more cells than this are kept in a list that every
+// query scans; queries spanning more fall back to scanning all entries.
+static constexpr long kMaxObjectCells = 64;
+static constexpr long kMaxQueryCells = 512;
+static constexpr double kMinCellSize = 0.5;
+
+static std::uint64_t cell_key(int x, int y, int z)
+{
+	const std::uint64_t mask = (1u << 21) - 1;
+	return ((std::uint64_t(x) & mask) << 42) | ((std::uint64_t(y) & mask) << 21) |
+		   (std::uint64_t(z) & mask);
+}
+
+static long cell_count(const int lo[3], const int hi[3])
+{
+	return long(hi[0] - lo[0] + 1) * long(hi[1] - lo[1] + 1) *
+		   long(hi[2] - lo[2] + 1);
+}
+
+// Cells twice the mean object size keep most objects in at most eight
+// cells and let them move a while before they change cells.
+void SpatialHash::choose_cell_size(const std::vector<HittablePtr> &objects)
+{
+	double total = 0.0;
+	int counted = 0;
+	for (const auto &o : objects)
+	{
+		AABB box;
+		if (!o->bounding_box(box) || o->is_beam())
+			continue;
+		Vec3 size = box.max - box.min;
+		total += std::max(size.x, std::max(size.y, size.z));
+		++counted;
+	}
+	cell_size = counted ? std::max(kMinCellSize, 2.0 * total / counted) : 1.0;
+	inv_cell = 1.0 / cell_size;
+}
+
+void SpatialHash::cell_range(const AABB &box, int lo[3], int hi[3]) const
+{
+	const double bmin[3] = {box.min.x, box.min.y, box.min.z};
+	const double bmax[3] = {box.max.x, box.max.y, box.max.z};
+	for (int a = 0; a < 3; ++a)
+	{
+		// Clamped so that huge boxes cannot overflow the cell index.
+		lo[a] = int(std::max(-1e6, std::min(1e6, std::floor(bmin[a] * inv_cell))));
+		hi[a] = int(std::max(-1e6, std::min(1e6, std::floor(bmax[a] * inv_cell))));
+	}
+}
+
+void SpatialHash::link(int slot)
+{
+	Entry &e = entries[slot];
+	if (e.large)
+	{
+		large_entries.push_back(slot);
+		return;
+	}
+	for (int x = e.lo[0]; x <= e.hi[0]; ++x)
+		for (int y = e.lo[1]; y <= e.hi[1]; ++y)
+			for (int z = e.lo[2]; z <= e.hi[2]; ++z)
+				cells[cell_key(x, y, z)].push_back(slot);
+}
+
+void SpatialHash::unlink(int slot)
+{
+	Entry &e = entries[slot];
+	if (e.large)
+	{
+		auto it = std::find(large_entries.begin(), large_entries.end(), slot);
+		if (it != large_entries.end())
+		{
+			*it = large_entries.back();
+			large_entries.pop_back();
+		}
+		return;
+	}
+	for (int x = e.lo[0]; x <= e.hi[0]; ++x)
+		for (int y = e.lo[1]; y <= e.hi[1]; ++y)
+			for (int z = e.lo[2]; z <= e.hi[2]; ++z)
+			{
+				auto cell = cells.find(cell_key(x, y, z));
+				if (cell == cells.end())
+					continue;
+				std::vector<int> &list = cell->second;
+				auto it = std::find(list.begin(), list.end(), slot);
+				if (it != list.end())
+				{
+					*it = list.back();
+					list.pop_back();
+				}
+				if (list.empty())
+					cells.erase(cell);
+			}
+}
+
+// Re-read the object's box and move it between cells if needed.
+void SpatialHash::place(int slot)
+{
+	Entry &e = entries[slot];
+	e.object->bounding_box(e.box);
+	int lo[3], hi[3];
+	cell_range(e.box, lo, hi);
+	bool large = cell_count(lo, hi) > kMaxObjectCells;
+	if (large == e.large && (large || (std::equal(lo, lo + 3, e.lo) &&
+									   std::equal(hi, hi + 3, e.hi))))
+		return;
+	unlink(slot);
+	std::copy(lo, lo + 3, e.lo);
+	std::copy(hi, hi + 3, e.hi);
+	e.large = large;
+	link(slot);
+}
+
+void SpatialHash::sync(const std::vector<HittablePtr> &objects)
+{
+	// A set with nothing in common with the stored one, such as a reloaded
+	// or the next level, gets a cell size of its own. The stored entries
+	// hold their objects, so a new object cannot reuse an old address.
+	bool kept = false;
+	for (const auto &o : objects)
+		if (o && slot_of.count(o.get()))
+		{
+			kept = true;
+			break;
+		}
+	if (!kept)
+		clear();
+	if (slot_of.empty())
+		choose_cell_size(objects);
+	++sync_stamp;
+	for (const auto &o : objects)
+	{
+		AABB box;
+		if (!o || !o->bounding_box(box))
+			continue;
+		auto found = slot_of.find(o.get());
+		int slot;
+		if (found != slot_of.end())
+		{
+			slot = found->second;
+		}
+		else
+		{
+			if (free_slots.empty())
+			{
+				slot = int(entries.size());
+				entries.emplace_back();
+			}
+			else
+			{
+				slot = free_slots.back();
+				free_slots.pop_back();
+			}
+			Entry &e = entries[slot];
+			e = Entry();
+			e.object = o;
+			e.box = box;
+			e.alive = true;
+			e.stamp = sync_stamp;
+			cell_range(box, e.lo, e.hi);
+			e.large = cell_count(e.lo, e.hi) > kMaxObjectCells;
+			slot_of[o.get()] = slot;
+			link(slot);
+			continue;
+		}
+		entries[slot].stamp = sync_stamp;
+		place(slot);
+	}
+	for (int slot = 0; slot < int(entries.size()); ++slot)
+	{
+		Entry &e = entries[slot];
+		if (!e.alive || e.stamp == sync_stamp)
+			continue;
+		unlink(slot);
+		slot_of.erase(e.object.get());
+		e = Entry();
+		free_slots.push_back(slot);
+	}
+}
+
+void SpatialHash::update(const Hittable *object)
+{
+	auto found = slot_of.find(object);
+	if (found != slot_of.end())
+		place(found->second);
+}
+
+void SpatialHash::query(const AABB &range, std::vector<HittablePtr> &out) const
+{
+	if (slot_of.empty())
+		return;
+	int lo[3], hi[3];
+	cell_range(range, lo, hi);
+	if (cell_count(lo, hi) > kMaxQueryCells)
+	{
+		for (const Entry &e : entries)
+			if (e.alive && e.box.intersects(range))
+				out.push_back(e.object);
+		return;
+	}
+	if (seen.size() < entries.size())
+		seen.resize(entries.size(), 0);
+	if (++query_stamp == 0)
+	{
+		std::fill(seen.begin(), seen.end(), 0);
+		query_stamp = 1;
+	}
+	auto visit = [&](int slot)
+	{
+		if (seen[slot] == query_stamp)
+			return;
+		seen[slot] = query_stamp;
+		if (entries[slot].box.intersects(range))
+			out.push_back(entries[slot].object);
+	};
+	for (int slot : large_entries)
+		visit(slot);
+	for (int x = lo[0]; x <= hi[0]; ++x)
+		for (int y = lo[1]; y <= hi[1]; ++y)
+			for (int z = lo[2]; z <= hi[2]; ++z)
+			{
+				auto cell = cells.find(cell_key(x, y, z));
+				if (cell == cells.end())
+					continue;
+				for (int slot : cell->second)
+					visit(slot);
+			}
+}
+
+void SpatialHash::clear()
+{
+	entries.clear();
+	free_slots.clear();
+	large_entries.clear();
+	slot_of.clear();
+	cells.clear();
+	seen.clear();
+	query_stamp = 0;
+	cell_size = 0.0;
+	inv_cell = 0.0;
+}
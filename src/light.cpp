@@ -1,4 +1,5 @@
 #include "light.hpp"
+#include <cmath>
 #include <utility>
 
 PointLight::PointLight(const Vec3 &p, const Vec3 &c, double i,
@@ -12,4 +13,23 @@ PointLight::PointLight(const Vec3 &p, const Vec3 &c, double i,
 {
 }
 
+PreparedLight prepare_light(const PointLight &L)
+{
+        PreparedLight P{};
+        P.source = &L;
+        P.position = L.position;
+        P.direction = L.direction;
+        double len2 = L.direction.length_squared();
+        P.has_axis = len2 > 1e-12;
+        P.axis = P.has_axis ? L.direction / std::sqrt(len2) : Vec3(0, 0, 1);
+        P.color = L.color;
+        P.intensity = L.intensity;
+        P.radiance = L.color * L.intensity;
+        P.cutoff_cos = L.cutoff_cos;
+        P.inv_range = L.range > 0.0 ? 1.0 / L.range : 0.0;
+        P.beam = L.beam_spotlight && L.spot_radius > 0.0;
+        P.radius_sq = P.beam ? L.spot_radius * L.spot_radius : 0.0;
+        return P;
+}
+
 Ambient::Ambient(const Vec3 &c, double i) : color(c), intensity(i) {}
@@ -1,6 +1,9 @@
 #include "Application.hpp"
+#include "BatchRender.hpp"
+#include "Benchmark.hpp"
 #include "GameSession.hpp"
 #include "CommandLine.hpp"
+#include "InputRecorder.hpp"
 #include "MainMenu.hpp"
 #include "Settings.hpp"
 #include <algorithm>
@@ -80,6 +83,28 @@ std::optional<std::string> find_first_tutorial_scene()
         return tutorials.front().string();
 }
 
+/// Play the scene straight away, without menus, while recording the input
+/// or replaying an earlier recording at the size and quality it ran at.
+bool run_recorded_session(const std::string &scene_path)
+{
+        InputRecorder::Header header;
+        header.width = g_settings.width;
+        header.height = g_settings.height;
+        header.quality = g_settings.quality;
+        bool started = replay_path().empty()
+                               ? g_input_recorder.start_recording(record_path(), header)
+                               : g_input_recorder.start_replay(replay_path());
+        if (!started)
+                return false;
+        header = g_input_recorder.header();
+        g_settings.quality = header.quality;
+        run_application(scene_path, header.width, header.height, header.quality, false,
+                        nullptr);
+        g_input_recorder.finish();
+        load_settings();
+        return true;
+}
+
 } // namespace
 
 /**
@@ -94,6 +119,18 @@ int main(int argc, char **argv)
                 return 1;
         }
         load_settings();
+        if (bench_options().enabled)
+        {
+                return run_benchmark(bench_options()) ? 0 : 1;
+        }
+        if (batch_options().enabled)
+        {
+                return run_batch_render(batch_options()) ? 0 : 1;
+        }
+        if (!record_path().empty() || !replay_path().empty())
+        {
+                return run_recorded_session(default_scene_path) ? 0 : 1;
+        }
 
         GameSession session_state;
 
@@ -5,6 +5,7 @@
 namespace
 {
 constexpr double kAltColorAmount = 0.35;
+constexpr double kMaxSquaringExponent = 1024.0;
 
 Vec3 brighten_color(const Vec3 &color)
 {
@@ -22,6 +23,24 @@ Vec3 darken_color(const Vec3 &color)
 }
 }
 
+double specular_power(double base, double exponent)
+{
+        if (!(exponent >= 0.0 && exponent <= kMaxSquaringExponent))
+                return std::pow(base, exponent);
+        int e = static_cast<int>(exponent);
+        if (e != exponent)
+                return std::pow(base, exponent);
+        double result = 1.0;
+        while (e)
+        {
+                if (e & 1)
+                        result *= base;
+                base *= base;
+                e >>= 1;
+        }
+        return result;
+}
+
 Vec3 phong(const Material &m, const Ambient &ambient,
                    const std::vector<PointLight> &lights, const Vec3 &p, const Vec3 &n,
                    const Vec3 &eye)
@@ -95,7 +114,7 @@ Vec3 phong(const Material &m, const Ambient &ambient,
                 if (diff <= 1e-6)
                         continue;
                 Vec3 h = (ldir + eye).normalized();
-                double spec = std::pow(std::max(0.0, Vec3::dot(n, h)), m.specular_exp) *
+                double spec = specular_power(std::max(0.0, Vec3::dot(n, h)), m.specular_exp) *
                                           m.specular_k;
                 c += Vec3(col.x * L.color.x * L.intensity * diff * atten +
                                           L.color.x * spec * atten,
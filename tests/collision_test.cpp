@@ -0,0 +1,212 @@
+// Regression checks for swept collision: dragging objects and walking the
+// camera into contact, then away from and along whatever stopped them.
+// Usage: collision_test
+#include "Camera.hpp"
+#include "Collision.hpp"
+#include "Config.hpp"
+#include "Cube.hpp"
+#include "Cylinder.hpp"
+#include "Scene.hpp"
+#include "Sphere.hpp"
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+	if (!ok)
+	{
+		std::printf("FAIL: %s\n", what);
+		++failures;
+	}
+}
+
+bool moved_fully(const Vec3 &moved, const Vec3 &delta)
+{
+	return (moved - delta).length() < 1e-9;
+}
+
+// Drag a unit sphere from the origin diagonally into obstacle until a step
+// is cut short, then move it away from the contact and sideways along it.
+// axis is the obstacle's axis (zero for a sphere); everything lies in z=0,
+// so z is always tangent to the contact.
+void drag_into(HittablePtr obstacle, const Vec3 &centre, const Vec3 &axis, const char *name)
+{
+	Scene scene;
+	auto ball = std::make_shared<Sphere>(Vec3(0, 0, 0), 1.0, 0, 0);
+	ball->movable = true;
+	obstacle->object_id = 1;
+	scene.objects.push_back(ball);
+	scene.objects.push_back(obstacle);
+	scene.build_bvh();
+
+	Vec3 step(0.25, 0.25, 0);
+	Vec3 moved(0, 0, 0);
+	bool stopped = false;
+	for (int i = 0; i < 20 && !stopped; ++i)
+	{
+		moved = scene.move_with_collision(0, step);
+		stopped = !moved_fully(moved, step);
+	}
+	std::printf("%-10s rests at (%.4f, %.4f, %.4f)\n", name, ball->center.x, ball->center.y,
+				ball->center.z);
+	check(stopped, "drag was never stopped");
+	check(!precise_collision(ball, obstacle), "dragged object overlaps the obstacle");
+	// The diagonal drag is partly tangential, so the object slides rather
+	// than stopping dead at the first contact.
+	Vec3 away = ball->center - centre;
+	away = away - axis * Vec3::dot(away, axis);
+	away = away.normalized();
+	Vec3 slide = moved - away * Vec3::dot(moved, away);
+	check(slide.length() > 0.05, "drag lost its tangential part");
+
+	for (int i = 0; i < 3; ++i)
+		check(moved_fully(scene.move_with_collision(0, away * 0.1), away * 0.1),
+			  "move away is blocked");
+	for (int i = 0; i < 3; ++i)
+		scene.move_with_collision(0, away * -0.1);
+	Vec3 tangent(0, 0, 0.1);
+	for (int i = 0; i < 3; ++i)
+		check(scene.move_with_collision(0, tangent).length() > 0.5 * tangent.length(),
+			  "move along the contact is blocked");
+	check(!precise_collision(ball, obstacle), "object ends up inside the obstacle");
+}
+
+// Walk the camera forward, off-centre, into obstacle at the origin until a
+// step is cut short, then back out and strafe along y, which is tangent to
+// every obstacle used here.
+void walk_into(HittablePtr obstacle, const char *name)
+{
+	Scene scene;
+	obstacle->object_id = 0;
+	obstacle->material_id = 0;
+	scene.objects.push_back(obstacle);
+	scene.build_bvh();
+	std::vector<Material> mats(1);
+	Camera cam(Vec3(0.3, 0, -5), Vec3(0.3, 0, 0), 60.0, 1.0);
+	auto touches = [&]()
+	{
+		HittablePtr body = std::make_shared<Sphere>(cam.origin, CAMERA_COLLISION_RADIUS, -1, -1);
+		return precise_collision(body, obstacle);
+	};
+
+	Vec3 step(0, 0, 0.25);
+	Vec3 moved(0, 0, 0);
+	bool stopped = false;
+	for (int i = 0; i < 40 && !stopped; ++i)
+	{
+		moved = scene.move_camera(cam, step, mats);
+		stopped = !moved_fully(moved, step);
+	}
+	std::printf("camera at %-10s stops at (%.4f, %.4f, %.4f)\n", name, cam.origin.x,
+				cam.origin.y, cam.origin.z);
+	check(stopped, "camera walked through the obstacle");
+	check(!touches(), "camera body overlaps the obstacle");
+	check(std::abs(moved.x) > 1e-3, "camera does not slide along the surface");
+
+	Vec3 back(0, 0, -0.1);
+	for (int i = 0; i < 3; ++i)
+		check(moved_fully(scene.move_camera(cam, back, mats), back), "camera cannot back out");
+	for (int i = 0; i < 3; ++i)
+		scene.move_camera(cam, (-1) * back, mats);
+	Vec3 strafe(0, 0.1, 0);
+	for (int i = 0; i < 3; ++i)
+		check(scene.move_camera(cam, strafe, mats).length() > 0.5 * strafe.length(),
+			  "camera cannot strafe along the surface");
+	check(!touches(), "camera body ends up inside the obstacle");
+}
+
+// Drag a unit sphere, its bottom starting height above the top of a wide
+// flat box, across the box with a slight downward component, as a player
+// sliding an object along a table does. It must settle onto the face and
+// slide the whole way without sinking in.
+void drag_across(double inward, double height)
+{
+	Scene scene;
+	auto ball = std::make_shared<Sphere>(Vec3(-45, 2.0 + height, 0), 1.0, 0, 0);
+	ball->movable = true;
+	auto table = std::make_shared<Cube>(Vec3(0, 0, 0), Vec3(0, 1, 0), 100.0, 100.0, 2.0, 1, 0);
+	scene.objects.push_back(ball);
+	scene.objects.push_back(table);
+	scene.build_bvh();
+
+	Vec3 step(0.04, -inward, 0);
+	int stalls = 0;
+	bool sank = false;
+	while (ball->center.x < 45.0 && stalls < 10)
+	{
+		Vec3 moved = scene.move_with_collision(0, step);
+		stalls = moved.x < 0.5 * step.x ? stalls + 1 : 0;
+		sank = sank || precise_collision(ball, table);
+	}
+	std::printf("slide dy=%-8g ends at (%.4f, %.4f, %.4f)\n", -inward, ball->center.x,
+				ball->center.y, ball->center.z);
+	check(ball->center.x >= 45.0, "slide across a box face stops dead");
+	check(!sank, "object sinks into the box face");
+}
+
+// Walk the camera diagonally into the face x = 1 of a wide wall, with a
+// lateral step of lateral per frame. The body must slide along the wall
+// without ever sinking into it.
+void walk_along(double lateral)
+{
+	Scene scene;
+	auto wall = std::make_shared<Cube>(Vec3(1.5, 0, 0), Vec3(1, 0, 0), 6.0, 6.0, 1.0, 0, 0);
+	scene.objects.push_back(wall);
+	scene.build_bvh();
+	std::vector<Material> mats(1);
+	Camera cam(Vec3(0.5, 0, -2), Vec3(0.5, 0, 0), 60.0, 1.0);
+
+	Vec3 step(lateral, 0, 0.1);
+	bool sank = false;
+	for (int i = 0; i < 30; ++i)
+	{
+		scene.move_camera(cam, step, mats);
+		HittablePtr body = std::make_shared<Sphere>(cam.origin, CAMERA_COLLISION_RADIUS, -1, -1);
+		sank = sank || precise_collision(body, wall);
+	}
+	std::printf("camera walk dx=%-5g ends at (%.4f, %.4f, %.4f)\n", lateral, cam.origin.x,
+				cam.origin.y, cam.origin.z);
+	check(!sank, "camera body sinks into the wall while sliding");
+	check(cam.origin.x < 1.0 - CAMERA_COLLISION_RADIUS, "camera centre reaches the wall");
+	check(cam.origin.z > 0.9, "camera does not slide along the wall");
+}
+
+} // namespace
+
+int main()
+{
+	// A sphere beside the diagonal, so the drag hits it off-centre, and a
+	// tall cylinder standing along y.
+	drag_into(std::make_shared<Sphere>(Vec3(3, 1, 0), 1.0, 0, 0), Vec3(3, 1, 0), Vec3(0, 0, 0),
+			  "sphere");
+	drag_into(std::make_shared<Cylinder>(Vec3(3, 0, 0), Vec3(0, 1, 0), 1.0, 20.0, 0, 0),
+			  Vec3(3, 0, 0), Vec3(0, 1, 0), "cylinder");
+	drag_across(1e-2, 0.2);
+	drag_across(1e-3, 0.2);
+	drag_across(2e-4, 0.2);
+	// About 2.5e-4 rad into the face, starting inside the contact skin.
+	drag_across(1e-5, 0.5 * kContactDistance);
+	walk_into(std::make_shared<Sphere>(Vec3(0, 0, 0), 1.0, 0, 0), "sphere");
+	walk_into(std::make_shared<Cylinder>(Vec3(0, 0, 0), Vec3(0, 1, 0), 1.0, 20.0, 0, 0),
+			  "cylinder");
+	// Turned 30 degrees about y, so the camera meets a face at an angle.
+	walk_into(std::make_shared<Cube>(Vec3(0, 0, 0), Vec3(0.5, 0, std::sqrt(3.0) / 2), 2.0, 2.0,
+									 2.0, 0, 0),
+			  "box");
+	walk_along(0.01);
+	walk_along(0.05);
+	walk_along(0.2);
+	if (failures)
+	{
+		std::printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+	std::printf("all collision checks passed\n");
+	return 0;
+}
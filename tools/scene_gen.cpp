@@ -0,0 +1,358 @@
+// Writes procedural stress scenes in the level .toml format, for measuring
+// how the BVH, beam propagation and collision code scale with object count.
+// Solid objects sit one per cell of a jittered grid, so they never overlap
+// and the density stays the same at any size. Mirrors form two facing walls
+// above the grid, and beam sources fire between them at an angle that makes
+// each beam bounce `--bounces` times before it leaves the corridor.
+// Usage: scene_gen [--objects N] [--spheres N] [--cubes N] [--cylinders N]
+//                  [--cones N] [--mirrors N] [--beams N] [--bounces N]
+//                  [--transparent N] [--lights N] [--seed N] [-o out.toml]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr double kCell = 4.0;		 // grid cell of one solid object
+constexpr double kMaxSize = 1.4;	 // largest half extent inside a cell
+constexpr double kPanel = 4.0;		 // mirror panel edge
+constexpr double kPanelDepth = 0.2;
+constexpr double kCorridorWidth = 12.0;
+
+struct Options
+{
+	long spheres = 0;
+	long cubes = 0;
+	long cylinders = 0;
+	long cones = 0;
+	long mirrors = 0;
+	long beams = 0;
+	long bounces = 10;
+	long transparent = 0;
+	long lights = 3;
+	unsigned seed = 1;
+	std::string output;
+};
+
+struct V3
+{
+	double x, y, z;
+};
+
+V3 normalized(V3 v)
+{
+	double len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	return {v.x / len, v.y / len, v.z / len};
+}
+
+// Same number format as MapSaver: at most five decimals, integers bare.
+std::string num(double value)
+{
+	double rounded = std::round(value * 100000.0) / 100000.0;
+	if (std::fabs(rounded) < 1e-6)
+		rounded = 0.0;
+	double integral = std::round(rounded);
+	if (std::fabs(rounded - integral) < 1e-5)
+		return std::to_string(static_cast<long long>(integral));
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(5) << rounded;
+	return oss.str();
+}
+
+std::string vec(const V3 &v) { return "[" + num(v.x) + ", " + num(v.y) + ", " + num(v.z) + "]"; }
+
+std::string color(std::mt19937 &rng)
+{
+	std::uniform_int_distribution<int> channel(40, 255);
+	return "[" + std::to_string(channel(rng)) + ", " + std::to_string(channel(rng)) + ", " +
+		   std::to_string(channel(rng)) + "]";
+}
+
+const char *flag(bool value) { return value ? "true" : "false"; }
+
+V3 random_dir(std::mt19937 &rng)
+{
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	for (;;)
+	{
+		V3 d{unit(rng), unit(rng), unit(rng)};
+		double sq = d.x * d.x + d.y * d.y + d.z * d.z;
+		if (sq > 1e-3 && sq <= 1.0)
+			return normalized(d);
+	}
+}
+
+bool parse_count(const char *text, long &out)
+{
+	char *end = nullptr;
+	long value = std::strtol(text, &end, 10);
+	if (end == text || *end != '\0' || value < 0)
+		return false;
+	out = value;
+	return true;
+}
+
+void write_scene(std::ostream &out, const Options &opt)
+{
+	std::mt19937 rng(opt.seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+	// Kinds of the solid objects in cell order, shuffled so every kind is
+	// spread over the whole grid.
+	enum Kind
+	{
+		SphereKind,
+		CubeKind,
+		CylinderKind,
+		ConeKind
+	};
+	std::vector<Kind> kinds;
+	kinds.insert(kinds.end(), opt.spheres, SphereKind);
+	kinds.insert(kinds.end(), opt.cubes, CubeKind);
+	kinds.insert(kinds.end(), opt.cylinders, CylinderKind);
+	kinds.insert(kinds.end(), opt.cones, ConeKind);
+	std::shuffle(kinds.begin(), kinds.end(), rng);
+	std::vector<bool> transparent(kinds.size(), false);
+	std::fill(transparent.begin(),
+			  transparent.begin() + std::min<size_t>(opt.transparent, kinds.size()), true);
+	std::shuffle(transparent.begin(), transparent.end(), rng);
+
+	long side = 1;
+	while (side * side * side < static_cast<long>(kinds.size()))
+		++side;
+	double half_width = side * kCell * 0.5;
+	double top = side * kCell;
+
+	// Mirror corridor above the grid, walls at x = +-kCorridorWidth / 2.
+	long per_wall = (opt.mirrors + 1) / 2;
+	long rows = std::max(1L, static_cast<long>(std::sqrt(per_wall / 4.0)));
+	long cols = per_wall ? (per_wall + rows - 1) / rows : 4;
+	double corridor_y = top + kCell;
+	double corridor_length = cols * kPanel;
+	double corridor_z = -corridor_length * 0.5;
+
+	out << "[quota]\n";
+	out << "target = false\n";
+	out << "minimal_score = 0\n\n";
+
+	double view = std::max(half_width, corridor_length * 0.5);
+	out << "[camera]\n";
+	out << "id = \"camera\"\n";
+	out << "position = " << vec({0, top * 0.75 + kCell, -view - 2.5 * (half_width + kCell)})
+		<< "\n";
+	out << "lookdir = " << vec(normalized({0, -0.35, 1})) << "\n";
+	out << "fov = 90\n\n";
+
+	out << "[lighting.ambient]\n";
+	out << "intensity = 0.20000\n";
+	out << "color = [255, 255, 255]\n";
+	double light_intensity = std::min(0.8, 1.5 / std::max(1L, opt.lights));
+	for (long i = 0; i < opt.lights; ++i)
+	{
+		V3 p{(unit(rng) * 2 - 1) * (half_width + kCell), top + 2 * kCell * unit(rng) + 2,
+			 (unit(rng) * 2 - 1) * (half_width + kCell)};
+		out << "\n[[lighting.light_sources]]\n";
+		out << "id = \"light" << i + 1 << "\"\n";
+		out << "intensity = " << num(light_intensity) << "\n";
+		out << "position = " << vec(p) << "\n";
+		out << "color = [255, 255, 255]\n";
+	}
+	out << "\n";
+
+	out << "[[objects.planes]]\n";
+	out << "id = \"floor\"\n";
+	out << "color = [120, 120, 120]\n";
+	out << "position = [0, -0.5, 0]\n";
+	out << "dir = [0, 1, 0]\n";
+	out << "reflective = false\n";
+	out << "rotatable = false\n";
+	out << "movable = false\n";
+	out << "scorable = false\n";
+	out << "transparent = false\n\n";
+
+	std::uniform_real_distribution<double> size(0.4, kMaxSize);
+	long counters[4] = {};
+	for (size_t i = 0; i < kinds.size(); ++i)
+	{
+		long cx = static_cast<long>(i) % side;
+		long cy = static_cast<long>(i) / side % side;
+		long cz = static_cast<long>(i) / (side * side);
+		V3 centre{(cx + 0.5) * kCell - half_width, (cy + 0.5) * kCell,
+				  (cz + 0.5) * kCell - half_width};
+		// Jitter leaves at least kCell / 2 - kMaxSize of clearance per side.
+		double jitter = kCell * 0.5 - kMaxSize - 0.1;
+		centre.x += (unit(rng) * 2 - 1) * jitter;
+		centre.y += (unit(rng) * 2 - 1) * jitter;
+		centre.z += (unit(rng) * 2 - 1) * jitter;
+		V3 dir = random_dir(rng);
+		long index = ++counters[kinds[i]];
+		switch (kinds[i])
+		{
+		case SphereKind:
+			out << "[[objects.spheres]]\n";
+			out << "id = \"sphere" << index << "\"\n";
+			out << "color = " << color(rng) << "\n";
+			out << "position = " << vec(centre) << "\n";
+			out << "dir = [0.0, 1.0, 0.0]\n";
+			out << "radius = " << num(size(rng)) << "\n";
+			break;
+		case CubeKind:
+		{
+			// A box's half diagonal must stay within kMaxSize too.
+			double scale = kMaxSize / std::sqrt(3.0) * 2.0;
+			out << "[[objects.boxes]]\n";
+			out << "id = \"box" << index << "\"\n";
+			out << "color = " << color(rng) << "\n";
+			out << "position = " << vec(centre) << "\n";
+			out << "dir = " << vec(dir) << "\n";
+			out << "width = " << num(scale * (0.4 + 0.6 * unit(rng))) << "\n";
+			out << "height = " << num(scale * (0.4 + 0.6 * unit(rng))) << "\n";
+			out << "length = " << num(scale * (0.4 + 0.6 * unit(rng))) << "\n";
+			break;
+		}
+		case CylinderKind:
+		case ConeKind:
+		{
+			bool cone = kinds[i] == ConeKind;
+			double radius = 0.3 + 0.6 * unit(rng);
+			double height = 2.0 * std::sqrt(kMaxSize * kMaxSize - radius * radius);
+			out << (cone ? "[[objects.cones]]\n" : "[[objects.cylinders]]\n");
+			out << "id = \"" << (cone ? "cone" : "cylinder") << index << "\"\n";
+			out << "color = " << color(rng) << "\n";
+			out << "position = " << vec(centre) << "\n";
+			out << "dir = " << vec(dir) << "\n";
+			out << "radius = " << num(radius) << "\n";
+			out << "height = " << num(height * (0.5 + 0.5 * unit(rng))) << "\n";
+			break;
+		}
+		}
+		out << "reflective = false\n";
+		out << "rotatable = true\n";
+		out << "movable = true\n";
+		out << "scorable = true\n";
+		out << "transparent = " << flag(transparent[i]) << "\n\n";
+	}
+
+	for (long i = 0; i < opt.mirrors; ++i)
+	{
+		long wall = i % 2;
+		long slot = i / 2;
+		V3 centre{(wall ? 0.5 : -0.5) * (kCorridorWidth + kPanelDepth),
+				  corridor_y + (slot / cols + 0.5) * kPanel,
+				  corridor_z + (slot % cols + 0.5) * kPanel};
+		out << "[[objects.boxes]]\n";
+		out << "id = \"mirror" << i + 1 << "\"\n";
+		out << "color = [230, 230, 240]\n";
+		out << "position = " << vec(centre) << "\n";
+		out << "dir = " << (wall ? "[-1, 0, 0]" : "[1, 0, 0]") << "\n";
+		out << "width = " << num(kPanel) << "\n";
+		out << "height = " << num(kPanelDepth) << "\n";
+		out << "length = " << num(kPanel) << "\n";
+		out << "reflective = true\n";
+		out << "rotatable = true\n";
+		out << "movable = false\n";
+		out << "scorable = false\n";
+		out << "transparent = false\n\n";
+	}
+
+	// Each crossing of the corridor advances the beam by `slope` corridor
+	// widths along z; bounces + 1 crossings span the mirror walls.
+	double slope = corridor_length / ((opt.bounces + 1) * kCorridorWidth);
+	V3 dir = normalized({1, 0, slope});
+	double length = (opt.bounces + 1) * kCorridorWidth / dir.x + kCell;
+	for (long i = 0; i < opt.beams; ++i)
+	{
+		double height = rows * kPanel;
+		V3 p{-kCorridorWidth * 0.5 + 1.0, corridor_y + (i + 0.5) / opt.beams * height,
+			 corridor_z + 1.0};
+		out << "[[beam.sources]]\n";
+		out << "id = \"beam_source" << i + 1 << "\"\n";
+		out << "intensity = 1\n";
+		out << "position = " << vec(p) << "\n";
+		out << "dir = " << vec(dir) << "\n";
+		out << "color = " << color(rng) << "\n";
+		out << "radius = 0.40000\n";
+		out << "length = " << num(length) << "\n";
+		out << "movable = false\n";
+		out << "rotatable = true\n";
+		out << "scorable = false\n";
+		out << "with_laser = true\n\n";
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string name = argv[i];
+		long value = 0;
+		bool ok = i + 1 < argc;
+		if (ok && name != "-o")
+			ok = parse_count(argv[i + 1], value);
+		if (ok && name == "--objects")
+		{
+			// Split evenly over the four solid kinds.
+			opt.cubes = opt.cylinders = opt.cones = value / 4;
+			opt.spheres = value - 3 * (value / 4);
+		}
+		else if (ok && name == "--spheres")
+			opt.spheres = value;
+		else if (ok && name == "--cubes")
+			opt.cubes = value;
+		else if (ok && name == "--cylinders")
+			opt.cylinders = value;
+		else if (ok && name == "--cones")
+			opt.cones = value;
+		else if (ok && name == "--mirrors")
+			opt.mirrors = value;
+		else if (ok && name == "--beams")
+			opt.beams = value;
+		else if (ok && name == "--bounces")
+			opt.bounces = value;
+		else if (ok && name == "--transparent")
+			opt.transparent = value;
+		else if (ok && name == "--lights")
+			opt.lights = value;
+		else if (ok && name == "--seed")
+			opt.seed = static_cast<unsigned>(value);
+		else if (ok && name == "-o")
+			opt.output = argv[i + 1];
+		else
+		{
+			std::fprintf(stderr,
+						 "Usage: %s [--objects N] [--spheres N] [--cubes N] [--cylinders N]"
+						 " [--cones N] [--mirrors N] [--beams N] [--bounces N]"
+						 " [--transparent N] [--lights N] [--seed N] [-o out.toml]\n",
+						 argv[0]);
+			return 1;
+		}
+		++i;
+	}
+
+	if (opt.output.empty())
+	{
+		write_scene(std::cout, opt);
+		return std::cout ? 0 : 1;
+	}
+	std::ofstream out(opt.output);
+	if (out)
+		write_scene(out, opt);
+	if (!out)
+	{
+		std::fprintf(stderr, "Cannot write %s\n", opt.output.c_str());
+		return 1;
+	}
+	return 0;
+}